@@ -0,0 +1,301 @@
+//
+// File "AdaptiveSurface.cpp"
+// Implementation of the class AdaptiveSurface
+//
+#include <math.h>
+#include "AdaptiveSurface.h"
+
+// Sides of a cell
+enum { RIGHT_SIDE = 0, TOP_SIDE = 1, LEFT_SIDE = 2, BOTTOM_SIDE = 3 };
+
+// Children of a cell: 0 - left bottom, 1 - right bottom,
+// 2 - left top, 3 - right top. Children adjacent to each side:
+static const int sideChildren[4][2] = {
+    { 1, 3 },   // Right
+    { 2, 3 },   // Top
+    { 0, 2 },   // Left
+    { 0, 1 }    // Bottom
+};
+
+AdaptiveSurface::AdaptiveSurface():
+    m_Vertices(),
+    m_Normals(),
+    m_Triangles(),
+    m_Function(0),
+    m_XMin(0.),
+    m_YMin(0.),
+    m_DX(1.),
+    m_DY(1.),
+    m_MaxLevel(0),
+    m_Size(1),
+    m_Cells(),
+    m_Values(),
+    m_VertexIndex()
+{}
+
+void AdaptiveSurface::build(
+    const SurfaceFunction& f,
+    double xmin, double xmax,
+    double ymin, double ymax,
+    double tolerance,
+    int minLevel /* = 3 */,
+    int maxLevel /* = 7 */
+) {
+    if (maxLevel > 14)
+        maxLevel = 14;
+    if (minLevel > maxLevel)
+        minLevel = maxLevel;
+
+    m_Function = &f;
+    m_MaxLevel = maxLevel;
+    m_Size = 1 << maxLevel;
+    m_XMin = xmin;
+    m_YMin = ymin;
+    m_DX = (xmax - xmin) / m_Size;
+    m_DY = (ymax - ymin) / m_Size;
+
+    m_Vertices.clear();
+    m_Normals.clear();
+    m_Triangles.clear();
+    m_Cells.clear();
+    m_Values.clear();
+    m_VertexIndex.clear();
+
+    Cell root;
+    root.ix = 0; root.iy = 0;
+    root.level = 0;
+    root.child = (-1);
+    m_Cells.push_back(root);
+
+    // Refinement. New cells are appended to the array,
+    // so a single pass visits all of them.
+    for (int i = 0; i < (int) m_Cells.size(); ++i) {
+        Cell c = m_Cells[i];
+        if (c.level >= maxLevel)
+            continue;
+        if (c.level < minLevel || deviation(c) > tolerance)
+            split(i);
+    }
+
+    balance();
+
+    for (int i = 0; i < (int) m_Cells.size(); ++i) {
+        if (m_Cells[i].child < 0)
+            triangulate(m_Cells[i]);
+    }
+
+    // Normals: F(x, y, z) = z - f(x, y), normal = grad F
+    int n = numVertices();
+    m_Normals.resize(3*n);
+    for (int i = 0; i < n; ++i) {
+        double x = m_Vertices[3*i];
+        double y = m_Vertices[3*i + 1];
+        double z, zx, zy;
+        f.gradientRow(&x, y, &z, &zx, &zy, 1);
+        double len = sqrt(zx*zx + zy*zy + 1.);
+        m_Normals[3*i]     = (float) (-zx / len);
+        m_Normals[3*i + 1] = (float) (-zy / len);
+        m_Normals[3*i + 2] = (float) (1. / len);
+    }
+
+    m_Values.clear();
+    m_VertexIndex.clear();
+    m_Function = 0;
+}
+
+double AdaptiveSurface::value(int ix, int iy) {
+    long k = key(ix, iy);
+    std::map<long, double>::const_iterator i = m_Values.find(k);
+    if (i != m_Values.end())
+        return i->second;
+    double z = m_Function->value(m_XMin + ix*m_DX, m_YMin + iy*m_DY);
+    m_Values[k] = z;
+    return z;
+}
+
+//
+// Maximal difference between the surface and the bilinear
+// interpolation of the corners, measured at the center of a cell
+// and at the midpoints of its sides
+//
+double AdaptiveSurface::deviation(const Cell& c) {
+    int s = m_Size >> c.level;
+    int h = s / 2;
+    double z00 = value(c.ix, c.iy);
+    double z10 = value(c.ix + s, c.iy);
+    double z01 = value(c.ix, c.iy + s);
+    double z11 = value(c.ix + s, c.iy + s);
+
+    double d = fabs(value(c.ix + h, c.iy + h) - (z00 + z10 + z01 + z11)/4.);
+    double e = fabs(value(c.ix + h, c.iy) - (z00 + z10)/2.);
+    if (e > d) d = e;
+    e = fabs(value(c.ix + h, c.iy + s) - (z01 + z11)/2.);
+    if (e > d) d = e;
+    e = fabs(value(c.ix, c.iy + h) - (z00 + z01)/2.);
+    if (e > d) d = e;
+    e = fabs(value(c.ix + s, c.iy + h) - (z10 + z11)/2.);
+    if (e > d) d = e;
+    return d;
+}
+
+void AdaptiveSurface::split(int cell) {
+    Cell c = m_Cells[cell];
+    int h = (m_Size >> c.level) / 2;
+    m_Cells[cell].child = (int) m_Cells.size();
+    for (int k = 0; k < 4; ++k) {
+        Cell child;
+        child.ix = c.ix + (k & 1) * h;
+        child.iy = c.iy + (k >> 1) * h;
+        child.level = c.level + 1;
+        child.child = (-1);
+        m_Cells.push_back(child);
+    }
+}
+
+//
+// Find the cell of the level <= maxLevel, that contains
+// the lattice point (ix, iy)
+//
+int AdaptiveSurface::findCell(int ix, int iy, int maxLevel) const {
+    int i = 0;
+    while (m_Cells[i].child >= 0 && m_Cells[i].level < maxLevel) {
+        const Cell& c = m_Cells[i];
+        int h = (m_Size >> c.level) / 2;
+        int k = 0;
+        if (ix >= c.ix + h)
+            k |= 1;
+        if (iy >= c.iy + h)
+            k |= 2;
+        i = c.child + k;
+    }
+    return i;
+}
+
+//
+// Is the neighbour across the side refined deeper than the cell c?
+// If "deeper" is true, check whether it is refined by two or more levels,
+// i.e. the quadtree is not balanced.
+//
+bool AdaptiveSurface::finerNeighbour(
+    const Cell& c, int side, bool deeper
+) const {
+    int s = m_Size >> c.level;
+    int ix = c.ix, iy = c.iy;
+    if (side == RIGHT_SIDE)
+        ix += s;
+    else if (side == TOP_SIDE)
+        iy += s;
+    else if (side == LEFT_SIDE)
+        ix -= s;
+    else
+        iy -= s;
+    if (ix < 0 || ix >= m_Size || iy < 0 || iy >= m_Size)
+        return false;   // Boundary of domain
+
+    const Cell& n = m_Cells[findCell(ix, iy, c.level)];
+    if (n.level < c.level || n.child < 0)
+        return false;   // Neighbour is coarser or of the same size
+    if (!deeper)
+        return true;
+
+    // Children of neighbour adjacent to the common side
+    int opposite = (side + 2) % 4;
+    return (
+        m_Cells[n.child + sideChildren[opposite][0]].child >= 0 ||
+        m_Cells[n.child + sideChildren[opposite][1]].child >= 0
+    );
+}
+
+//
+// Split the leaves until the levels of neighbouring leaves
+// differ by at most one
+//
+void AdaptiveSurface::balance() {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < (int) m_Cells.size(); ++i) {
+            if (m_Cells[i].child >= 0)
+                continue;
+            for (int side = 0; side < 4; ++side) {
+                if (finerNeighbour(m_Cells[i], side, true)) {
+                    split(i);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+int AdaptiveSurface::vertexIndex(int ix, int iy) {
+    long k = key(ix, iy);
+    std::map<long, int>::const_iterator i = m_VertexIndex.find(k);
+    if (i != m_VertexIndex.end())
+        return i->second;
+    int index = numVertices();
+    m_Vertices.push_back((float) (m_XMin + ix*m_DX));
+    m_Vertices.push_back((float) (m_YMin + iy*m_DY));
+    m_Vertices.push_back((float) value(ix, iy));
+    m_VertexIndex[k] = index;
+    return index;
+}
+
+//
+// A leaf without finer neighbours is divided into 2 triangles.
+// Otherwise we draw a fan around the center of cell; a side
+// with a finer neighbour gives 2 triangles through its midpoint.
+//
+void AdaptiveSurface::triangulate(const Cell& c) {
+    int s = m_Size >> c.level;
+    int h = s / 2;
+    bool split[4];
+    bool anySplit = false;
+    for (int side = 0; side < 4; ++side) {
+        split[side] = (h > 0 && finerNeighbour(c, side, false));
+        if (split[side])
+            anySplit = true;
+    }
+
+    // Corners counterclockwise, starting from the right bottom,
+    // so that the side k goes from corner k to corner k+1
+    int cx[4] = { c.ix + s, c.ix + s, c.ix,     c.ix };
+    int cy[4] = { c.iy,     c.iy + s, c.iy + s, c.iy };
+    int corner[4];
+    for (int k = 0; k < 4; ++k)
+        corner[k] = vertexIndex(cx[k], cy[k]);
+
+    if (!anySplit) {
+        m_Triangles.push_back(corner[3]);   // Left bottom
+        m_Triangles.push_back(corner[0]);   // Right bottom
+        m_Triangles.push_back(corner[1]);   // Right top
+
+        m_Triangles.push_back(corner[3]);
+        m_Triangles.push_back(corner[1]);
+        m_Triangles.push_back(corner[2]);   // Left top
+        return;
+    }
+
+    int center = vertexIndex(c.ix + h, c.iy + h);
+    for (int side = 0; side < 4; ++side) {
+        int a = corner[side];
+        int b = corner[(side + 1) % 4];
+        if (split[side]) {
+            int mid = vertexIndex(
+                (cx[side] + cx[(side + 1) % 4]) / 2,
+                (cy[side] + cy[(side + 1) % 4]) / 2
+            );
+            m_Triangles.push_back(center);
+            m_Triangles.push_back(a);
+            m_Triangles.push_back(mid);
+
+            m_Triangles.push_back(center);
+            m_Triangles.push_back(mid);
+            m_Triangles.push_back(b);
+        } else {
+            m_Triangles.push_back(center);
+            m_Triangles.push_back(a);
+            m_Triangles.push_back(b);
+        }
+    }
+}
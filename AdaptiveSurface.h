@@ -0,0 +1,87 @@
+//
+// File "AdaptiveSurface.h"
+//
+// The definition of the class AdaptiveSurface, that triangulates
+// a surface z = f(x, y) adaptively: a quadtree of cells is refined
+// where the surface deviates from the bilinear interpolation of cell
+// corners by more than a tolerance. Flat regions are covered by
+// large cells, oscillating regions by small ones.
+//
+// Neighbouring leaf cells differ by at most one level (the quadtree
+// is balanced), and a cell adjacent to a finer one includes the
+// midpoint of the common edge in its triangle fan, so the
+// triangulation has no cracks between levels.
+//
+#ifndef _ADAPTIVE_SURFACE_H
+#define _ADAPTIVE_SURFACE_H
+
+#include <vector>
+#include <map>
+#include "SurfaceGrid.h"
+
+class AdaptiveSurface {
+    // Quadtree cell. Coordinates and size are measured in steps
+    // of the finest lattice, that has 2^maxLevel steps along each axis.
+    struct Cell {
+        int ix;         // Left-bottom corner
+        int iy;
+        int level;      // Root has level 0
+        int child;      // Index of the first of 4 children or -1 for leaf
+    };
+
+    // Data members
+public:
+    std::vector<float>          m_Vertices;     // (x, y, z) for each vertex
+    std::vector<float>          m_Normals;      // Unit normals
+    std::vector<unsigned int>   m_Triangles;    // 3 vertex indices each
+
+private:
+    const SurfaceFunction*      m_Function;
+    double                      m_XMin;
+    double                      m_YMin;
+    double                      m_DX;           // Step of the finest lattice
+    double                      m_DY;
+    int                         m_MaxLevel;
+    int                         m_Size;         // 2^m_MaxLevel
+
+    std::vector<Cell>           m_Cells;
+    std::map<long, double>      m_Values;       // f at lattice points
+    std::map<long, int>         m_VertexIndex;  // Lattice point -> vertex
+
+    // Methods
+public:
+    AdaptiveSurface();
+
+    // Build the triangulation of [xmin, xmax]*[ymin, ymax].
+    // The cells of levels < minLevel are always refined,
+    // the cells of level maxLevel are never refined.
+    void build(
+        const SurfaceFunction& f,
+        double xmin, double xmax,
+        double ymin, double ymax,
+        double tolerance,
+        int minLevel = 3,
+        int maxLevel = 7
+    );
+
+    int numVertices() const  { return (int) m_Vertices.size() / 3; }
+    int numTriangles() const { return (int) m_Triangles.size() / 3; }
+
+    const float* vertex(int i) const { return &(m_Vertices[3*i]); }
+    const float* normal(int i) const { return &(m_Normals[3*i]); }
+
+private:
+    long key(int ix, int iy) const {
+        return (long) iy * (long) (m_Size + 1) + (long) ix;
+    }
+    double value(int ix, int iy);
+    double deviation(const Cell& c);
+    void split(int cell);
+    int findCell(int ix, int iy, int maxLevel) const;
+    bool finerNeighbour(const Cell& c, int side, bool deeper) const;
+    void balance();
+    int vertexIndex(int ix, int iy);
+    void triangulate(const Cell& c);
+};
+
+#endif /* _ADAPTIVE_SURFACE_H */
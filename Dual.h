@@ -0,0 +1,170 @@
+//
+// File "Dual.h"
+//
+// Dual numbers for forward-mode automatic differentiation
+// of functions of two variables z = f(x, y).
+//
+// A value of class Dual2 carries a number together with its partial
+// derivatives by x and y. If a function is written as a template
+//     template <class Real> Real f(const Real& x, const Real& y);
+// then f<double> computes the value only, and
+//     Dual2 z = f(Dual2::variableX(x), Dual2::variableY(y));
+// computes the value z.v and the exact gradient (z.dx, z.dy)
+// in one evaluation.
+//
+#ifndef _DUAL_H
+#define _DUAL_H
+
+#include <math.h>
+
+class Dual2 {
+public:
+    double v;       // Value
+    double dx;      // Partial derivative by x
+    double dy;      // Partial derivative by y
+
+    Dual2():
+        v(0.),
+        dx(0.),
+        dy(0.)
+    {}
+
+    Dual2(double c):            // Constant
+        v(c),
+        dx(0.),
+        dy(0.)
+    {}
+
+    Dual2(double value, double derX, double derY):
+        v(value),
+        dx(derX),
+        dy(derY)
+    {}
+
+    // Independent variables
+    static Dual2 variableX(double x) { return Dual2(x, 1., 0.); }
+    static Dual2 variableY(double y) { return Dual2(y, 0., 1.); }
+
+    Dual2 operator-() const { return Dual2(-v, -dx, -dy); }
+
+    Dual2& operator+=(const Dual2& a) {
+        v += a.v; dx += a.dx; dy += a.dy;
+        return *this;
+    }
+    Dual2& operator-=(const Dual2& a) {
+        v -= a.v; dx -= a.dx; dy -= a.dy;
+        return *this;
+    }
+    Dual2& operator*=(const Dual2& a) {
+        dx = dx*a.v + v*a.dx;
+        dy = dy*a.v + v*a.dy;
+        v *= a.v;
+        return *this;
+    }
+    Dual2& operator/=(const Dual2& a) {
+        double inv = 1. / a.v;
+        double q = v * inv;
+        dx = (dx - q*a.dx) * inv;
+        dy = (dy - q*a.dy) * inv;
+        v = q;
+        return *this;
+    }
+};
+
+// Arithmetic
+
+inline Dual2 operator+(const Dual2& a, const Dual2& b) {
+    return Dual2(a.v + b.v, a.dx + b.dx, a.dy + b.dy);
+}
+inline Dual2 operator+(const Dual2& a, double c) {
+    return Dual2(a.v + c, a.dx, a.dy);
+}
+inline Dual2 operator+(double c, const Dual2& a) {
+    return Dual2(c + a.v, a.dx, a.dy);
+}
+
+inline Dual2 operator-(const Dual2& a, const Dual2& b) {
+    return Dual2(a.v - b.v, a.dx - b.dx, a.dy - b.dy);
+}
+inline Dual2 operator-(const Dual2& a, double c) {
+    return Dual2(a.v - c, a.dx, a.dy);
+}
+inline Dual2 operator-(double c, const Dual2& a) {
+    return Dual2(c - a.v, -a.dx, -a.dy);
+}
+
+inline Dual2 operator*(const Dual2& a, const Dual2& b) {
+    return Dual2(
+        a.v * b.v,
+        a.dx*b.v + a.v*b.dx,
+        a.dy*b.v + a.v*b.dy
+    );
+}
+inline Dual2 operator*(const Dual2& a, double c) {
+    return Dual2(a.v * c, a.dx * c, a.dy * c);
+}
+inline Dual2 operator*(double c, const Dual2& a) {
+    return Dual2(c * a.v, c * a.dx, c * a.dy);
+}
+
+inline Dual2 operator/(const Dual2& a, const Dual2& b) {
+    double inv = 1. / b.v;
+    double q = a.v * inv;
+    return Dual2(
+        q,
+        (a.dx - q*b.dx) * inv,
+        (a.dy - q*b.dy) * inv
+    );
+}
+inline Dual2 operator/(const Dual2& a, double c) {
+    double inv = 1. / c;
+    return Dual2(a.v * inv, a.dx * inv, a.dy * inv);
+}
+inline Dual2 operator/(double c, const Dual2& a) {
+    double q = c / a.v;
+    double d = -q / a.v;
+    return Dual2(q, d * a.dx, d * a.dy);
+}
+
+// Elementary functions: f(a) = (f(a.v), f'(a.v) * a.dx, f'(a.v) * a.dy)
+
+// The derivative of sqrt at 0 is infinite; we take it to be 0 there,
+// that gives the right answer for smooth functions of r = sqrt(x*x + y*y)
+inline Dual2 sqrt(const Dual2& a) {
+    double s = sqrt(a.v);
+    double d = (s > 0.) ? 0.5 / s : 0.;
+    return Dual2(s, d * a.dx, d * a.dy);
+}
+
+inline Dual2 cos(const Dual2& a) {
+    double d = -sin(a.v);
+    return Dual2(cos(a.v), d * a.dx, d * a.dy);
+}
+
+inline Dual2 sin(const Dual2& a) {
+    double d = cos(a.v);
+    return Dual2(sin(a.v), d * a.dx, d * a.dy);
+}
+
+inline Dual2 exp(const Dual2& a) {
+    double e = exp(a.v);
+    return Dual2(e, e * a.dx, e * a.dy);
+}
+
+inline Dual2 log(const Dual2& a) {
+    double d = 1. / a.v;
+    return Dual2(log(a.v), d * a.dx, d * a.dy);
+}
+
+inline Dual2 atan(const Dual2& a) {
+    double d = 1. / (1. + a.v*a.v);
+    return Dual2(atan(a.v), d * a.dx, d * a.dy);
+}
+
+inline Dual2 pow(const Dual2& a, double p) {
+    double t = pow(a.v, p - 1.);
+    double d = p * t;
+    return Dual2(t * a.v, d * a.dx, d * a.dy);
+}
+
+#endif /* _DUAL_H */
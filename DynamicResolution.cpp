@@ -0,0 +1,162 @@
+//
+// File "DynamicResolution.cpp"
+// Implementation of the class DynamicResolution
+//
+#define GL_GLEXT_PROTOTYPES     // Framebuffer objects (OpenGL 3.0)
+
+#include <stdio.h>
+#include <math.h>
+#include "DynamicResolution.h"
+#include "FramePacer.h"
+#include <GL/glext.h>
+
+const double DynamicResolution::SCALE_STEP = 1. / 32.;
+const double DynamicResolution::MAX_DECREASE = 0.8;
+
+DynamicResolution::DynamicResolution(
+    double budget, double minScale /* = 0.25 */
+):
+    m_Framebuffer(0),
+    m_ColorBuffer(0),
+    m_DepthBuffer(0),
+    m_Width(0),
+    m_Height(0),
+    m_Budget(budget),
+    m_MinScale(minScale),
+    m_Scale(1.),
+    m_FrameStart(0.),
+    m_LastFrameTime(0.)
+{}
+
+DynamicResolution::~DynamicResolution() {
+    destroy();
+}
+
+bool DynamicResolution::supported() {
+    const char* version = (const char*) glGetString(GL_VERSION);
+    int major = 0;
+    if (version == 0 || sscanf(version, "%d", &major) < 1)
+        return false;
+    return (major >= 3);
+}
+
+bool DynamicResolution::resize(int width, int height) {
+    if (width <= 0 || height <= 0)
+        return false;
+    if (m_Framebuffer != 0 && width == m_Width && height == m_Height)
+        return true;
+    destroy();
+    m_Width = width;
+    m_Height = height;
+
+    glGenRenderbuffers(1, &m_ColorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_ColorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &m_DepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer);
+    glRenderbufferStorage(
+        GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height
+    );
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_Framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+    glFramebufferRenderbuffer(
+        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColorBuffer
+    );
+    glFramebufferRenderbuffer(
+        GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer
+    );
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Framebuffer object is incomplete: 0x%x\n", status);
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void DynamicResolution::destroy() {
+    if (m_Framebuffer != 0) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &m_Framebuffer);
+        glDeleteRenderbuffers(1, &m_ColorBuffer);
+        glDeleteRenderbuffers(1, &m_DepthBuffer);
+    }
+    m_Framebuffer = 0;
+    m_ColorBuffer = 0;
+    m_DepthBuffer = 0;
+}
+
+int DynamicResolution::renderWidth() const {
+    int w = (int) (m_Width * m_Scale + 0.5);
+    return (w > 0)? w : 1;
+}
+
+int DynamicResolution::renderHeight() const {
+    int h = (int) (m_Height * m_Scale + 0.5);
+    return (h > 0)? h : 1;
+}
+
+void DynamicResolution::bind() {
+    if (m_Framebuffer == 0)
+        return;
+    glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+    int w = renderWidth(), h = renderHeight();
+    glViewport(0, 0, w, h);
+    glScissor(0, 0, w, h);      // glClear must not fill the whole buffer
+    glEnable(GL_SCISSOR_TEST);
+    m_FrameStart = FramePacer::currentTime();
+}
+
+void DynamicResolution::suspend() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDisable(GL_SCISSOR_TEST);
+}
+
+void DynamicResolution::present() {
+    if (m_Framebuffer == 0)
+        return;
+    glFinish();                 // The frame is rendered
+    double frameTime = FramePacer::currentTime() - m_FrameStart;
+
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_Framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(
+        0, 0, renderWidth(), renderHeight(),
+        0, 0, m_Width, m_Height,
+        GL_COLOR_BUFFER_BIT,
+        (m_Scale < 1.)? GL_LINEAR : GL_NEAREST
+    );
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, m_Width, m_Height);
+
+    adjustScale(frameTime);
+}
+
+//
+// The time is proportional to the area, i.e. to the square of scale.
+// The scale grows by one step, when a frame one step larger would
+// still fit the budget, and drops at once (at most by MAX_DECREASE).
+//
+void DynamicResolution::adjustScale(double frameTime) {
+    m_LastFrameTime = frameTime;
+    if (frameTime <= 0. || m_Budget <= 0.)
+        return;
+    double desired = m_Scale * sqrt(m_Budget / frameTime);
+    double scale = m_Scale;
+    if (desired >= m_Scale + SCALE_STEP) {
+        scale = m_Scale + SCALE_STEP;
+    } else if (desired < m_Scale) {
+        if (desired < m_Scale * MAX_DECREASE)
+            desired = m_Scale * MAX_DECREASE;
+        scale = floor(desired / SCALE_STEP) * SCALE_STEP;
+    }
+    if (scale < m_MinScale)
+        scale = m_MinScale;
+    else if (scale > 1.)
+        scale = 1.;
+    m_Scale = scale;
+}
@@ -0,0 +1,86 @@
+//
+// File "DynamicResolution.h"
+//
+// The definition of the class DynamicResolution, that renders the
+// frames of a window into a framebuffer object at a reduced
+// resolution and upscales them to the window. With a software
+// rasterizer (Mesa llvmpipe) the time of a frame is roughly
+// proportional to the number of pixels, so a large window may be
+// drawn faster than the frame time budget at a smaller scale.
+//
+// The framebuffer object has the full size of the window (it is
+// reallocated only when the window is resized); a frame is drawn
+// into its lower left corner, restricted by the viewport and the
+// scissor box, and present() stretches that corner to the window
+// with linear filtering (glBlitFramebuffer). After each frame the
+// scale is adjusted so that the time of drawing fits the budget:
+// the time is measured from bind() (called by GLWindow::makeCurrent
+// before the scene is drawn) to the end of rendering (glFinish).
+// The scale drops quickly and grows slowly, by one SCALE_STEP
+// per frame, so it does not oscillate.
+//
+// OpenGL 3.0 framebuffer objects are required.
+//
+#ifndef _DYNAMIC_RESOLUTION_H
+#define _DYNAMIC_RESOLUTION_H
+
+#include <GL/gl.h>
+
+class DynamicResolution {
+public:
+    static const double SCALE_STEP;         // 1/32
+    static const double MAX_DECREASE;       // Factor of one adjustment
+
+    // Data members
+private:
+    GLuint  m_Framebuffer;
+    GLuint  m_ColorBuffer;
+    GLuint  m_DepthBuffer;
+    int     m_Width;            // Size of window and framebuffer object
+    int     m_Height;
+
+    double  m_Budget;           // Frame time budget, in seconds
+    double  m_MinScale;
+    double  m_Scale;            // Current scale, (m_MinScale, 1]
+    double  m_FrameStart;
+    double  m_LastFrameTime;
+
+    // Methods
+public:
+    DynamicResolution(double budget, double minScale = 0.25);
+    ~DynamicResolution();       // The context must be current
+
+    // Does the current context support framebuffer objects?
+    static bool supported();
+
+    // Allocate the framebuffer object for the window size.
+    // Returns false if the framebuffer is incomplete.
+    bool resize(int width, int height);
+    void destroy();
+
+    // Direct the drawing to the scaled part of framebuffer object
+    void bind();
+
+    // Draw into the window at full resolution until the next bind(),
+    // e.g. while the window is being resized
+    void suspend();
+
+    // Upscale the frame to the window (framebuffer 0), restore the
+    // full viewport and adjust the scale for the next frame
+    void present();
+
+    double scale() const            { return m_Scale; }
+    double budget() const           { return m_Budget; }
+    void setBudget(double budget)   { m_Budget = budget; }
+    double lastFrameTime() const    { return m_LastFrameTime; }
+    int renderWidth() const;
+    int renderHeight() const;
+
+private:
+    DynamicResolution(const DynamicResolution&);            // Not impl.
+    DynamicResolution& operator=(const DynamicResolution&); // Not impl.
+
+    void adjustScale(double frameTime);
+};
+
+#endif /* _DYNAMIC_RESOLUTION_H */
@@ -0,0 +1,324 @@
+//
+// File "FrameCapture.cpp"
+// Implementation of the class FrameCapture
+//
+#define GL_GLEXT_PROTOTYPES     // Pixel buffer objects (OpenGL 2.1)
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "FrameCapture.h"
+#include <GL/glext.h>
+
+FrameCapture::FrameCapture():
+    m_Format(PPM_SEQUENCE),
+    m_Width(0),
+    m_Height(0),
+    m_FramesPerSecond(25),
+    m_Active(false),
+    m_Stream(0),
+    m_NumBuffers(0),
+    m_Buffers(0),
+    m_NextBuffer(0),
+    m_PendingBuffers(0),
+    m_QueueLength(0),
+    m_Queue(0),
+    m_QueueHead(0),
+    m_QueueSize(0),
+    m_Terminate(false),
+    m_FramesCaptured(0),
+    m_FramesWritten(0),
+    m_FramesDropped(0)
+{
+    m_FileName[0] = 0;
+    pthread_mutex_init(&m_Mutex, 0);
+    pthread_cond_init(&m_Cond, 0);
+}
+
+FrameCapture::~FrameCapture() {
+    stop();
+    pthread_cond_destroy(&m_Cond);
+    pthread_mutex_destroy(&m_Mutex);
+}
+
+bool FrameCapture::start(
+    const char* fileName,
+    int width, int height,
+    int framesPerSecond /* = 25 */,
+    int numBuffers /* = 3 */,
+    int queueLength /* = 8 */
+) {
+    stop();
+
+    strncpy(m_FileName, fileName, 255);
+    m_FileName[255] = 0;
+    int len = (int) strlen(m_FileName);
+    if (len > 4 && strcmp(m_FileName + len - 4, ".y4m") == 0) {
+        m_Format = Y4M_STREAM;
+        width &= ~1;            // 4:2:0 chroma needs even sizes
+        height &= ~1;
+    } else {
+        m_Format = PPM_SEQUENCE;
+        if (!validPattern(m_FileName)) {
+            fprintf(
+                stderr, "Invalid pattern of frame files: %s\n", m_FileName
+            );
+            return false;
+        }
+    }
+    if (width <= 0 || height <= 0)
+        return false;
+    m_Width = width;
+    m_Height = height;
+    m_FramesPerSecond = framesPerSecond;
+
+    if (m_Format == Y4M_STREAM) {
+        m_Stream = fopen(m_FileName, "wb");
+        if (m_Stream == 0) {
+            perror("Cannot open a video file");
+            return false;
+        }
+        fprintf(
+            m_Stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+            m_Width, m_Height, m_FramesPerSecond
+        );
+    }
+
+    m_NumBuffers = (numBuffers > 1)? numBuffers : 2;
+    m_Buffers = new GLuint[m_NumBuffers];
+    glGenBuffers(m_NumBuffers, m_Buffers);
+    for (int i = 0; i < m_NumBuffers; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_Buffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameSize(), 0, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_NextBuffer = 0;
+    m_PendingBuffers = 0;
+
+    m_QueueLength = (queueLength > 0)? queueLength : 1;
+    m_Queue = new unsigned char*[m_QueueLength];
+    for (int i = 0; i < m_QueueLength; ++i)
+        m_Queue[i] = new unsigned char[frameSize()];
+    m_QueueHead = 0;
+    m_QueueSize = 0;
+
+    m_FramesCaptured = 0;
+    m_FramesWritten = 0;
+    m_FramesDropped = 0;
+    m_Terminate = false;
+    if (pthread_create(&m_Writer, 0, &writerProc, this) != 0) {
+        perror("Cannot create a writer thread");
+        m_Active = true;        // Release the resources
+        m_Terminate = true;
+        stop();
+        return false;
+    }
+    m_Active = true;
+    return true;
+}
+
+//
+// Start the transfer of the current frame into the next PBO.
+// If all PBOs are busy, the oldest one is retrieved first:
+// it was filled m_NumBuffers frames ago, so its transfer
+// has completed and mapping it does not wait for the GPU.
+//
+void FrameCapture::captureFrame() {
+    if (!m_Active)
+        return;
+    if (m_PendingBuffers == m_NumBuffers)
+        retrieveFrame();
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_Buffers[m_NextBuffer]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_Width, m_Height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_NextBuffer = (m_NextBuffer + 1) % m_NumBuffers;
+    ++m_PendingBuffers;
+    ++m_FramesCaptured;
+}
+
+void FrameCapture::retrieveFrame() {
+    int buffer = (
+        m_NextBuffer - m_PendingBuffers + m_NumBuffers
+    ) % m_NumBuffers;
+    --m_PendingBuffers;
+
+    // The tail slot of queue is not visible to the writer
+    // until m_QueueSize is incremented
+    pthread_mutex_lock(&m_Mutex);
+    bool full = (m_QueueSize == m_QueueLength);
+    int tail = (m_QueueHead + m_QueueSize) % m_QueueLength;
+    pthread_mutex_unlock(&m_Mutex);
+    if (full) {
+        ++m_FramesDropped;      // The writer is too slow
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_Buffers[buffer]);
+    const void* pixels = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    bool mapped = (pixels != 0);
+    if (mapped) {
+        memcpy(m_Queue[tail], pixels, frameSize());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!mapped) {
+        ++m_FramesDropped;
+        return;
+    }
+
+    pthread_mutex_lock(&m_Mutex);
+    ++m_QueueSize;
+    pthread_cond_signal(&m_Cond);
+    pthread_mutex_unlock(&m_Mutex);
+}
+
+void FrameCapture::stop() {
+    if (!m_Active)
+        return;
+
+    while (m_PendingBuffers > 0)
+        retrieveFrame();
+
+    pthread_mutex_lock(&m_Mutex);
+    bool writerStarted = !m_Terminate;
+    m_Terminate = true;
+    pthread_cond_signal(&m_Cond);
+    pthread_mutex_unlock(&m_Mutex);
+    if (writerStarted)
+        pthread_join(m_Writer, 0);
+
+    glDeleteBuffers(m_NumBuffers, m_Buffers);
+    delete[] m_Buffers;
+    m_Buffers = 0;
+    m_NumBuffers = 0;
+
+    for (int i = 0; i < m_QueueLength; ++i)
+        delete[] m_Queue[i];
+    delete[] m_Queue;
+    m_Queue = 0;
+    m_QueueLength = 0;
+    m_QueueSize = 0;
+
+    if (m_Stream != 0) {
+        fclose(m_Stream);
+        m_Stream = 0;
+    }
+    m_Active = false;
+}
+
+int FrameCapture::framesWritten() const {
+    pthread_mutex_lock(&m_Mutex);
+    int n = m_FramesWritten;
+    pthread_mutex_unlock(&m_Mutex);
+    return n;
+}
+
+void* FrameCapture::writerProc(void* capture) {
+    ((FrameCapture*) capture)->writerLoop();
+    return 0;
+}
+
+// The writer thread: writes the queued frames until stop() is called
+void FrameCapture::writerLoop() {
+    pthread_mutex_lock(&m_Mutex);
+    while (true) {
+        while (m_QueueSize == 0 && !m_Terminate)
+            pthread_cond_wait(&m_Cond, &m_Mutex);
+        if (m_QueueSize == 0)
+            break;              // Terminated, all frames written
+        const unsigned char* pixels = m_Queue[m_QueueHead];
+        int frameNumber = m_FramesWritten;
+        pthread_mutex_unlock(&m_Mutex);
+
+        writeFrame(pixels, frameNumber);
+
+        pthread_mutex_lock(&m_Mutex);
+        m_QueueHead = (m_QueueHead + 1) % m_QueueLength;
+        --m_QueueSize;
+        ++m_FramesWritten;
+    }
+    pthread_mutex_unlock(&m_Mutex);
+}
+
+static inline unsigned char clampByte(double v) {
+    if (v <= 0.)
+        return 0;
+    if (v >= 255.)
+        return 255;
+    return (unsigned char) (v + 0.5);
+}
+
+bool FrameCapture::validPattern(const char* pattern) {
+    int numConversions = 0;
+    const char* p = pattern;
+    while (*p != 0) {
+        if (*p++ != '%')
+            continue;
+        if (*p == '%') {
+            ++p;
+            continue;
+        }
+        if (*p == '0')
+            ++p;
+        for (int i = 0; i < 2 && isdigit((unsigned char) *p); ++i)
+            ++p;
+        if (*p != 'd')
+            return false;
+        ++p;
+        ++numConversions;
+    }
+    return (numConversions <= 1);
+}
+
+//
+// Pixels are RGB rows from bottom to top, as read by OpenGL
+//
+void FrameCapture::writeFrame(const unsigned char* pixels, int frameNumber) {
+    int rowSize = 3 * m_Width;
+
+    if (m_Format == PPM_SEQUENCE) {
+        char name[512];
+        snprintf(name, sizeof(name), m_FileName, frameNumber);
+        FILE* f = fopen(name, "wb");
+        if (f == 0) {
+            perror("Cannot open a frame file");
+            return;
+        }
+        fprintf(f, "P6\n%d %d\n255\n", m_Width, m_Height);
+        for (int y = m_Height - 1; y >= 0; --y)
+            fwrite(pixels + rowSize*y, 1, rowSize, f);
+        fclose(f);
+        return;
+    }
+
+    // Y4M: full range BT.601 (JPEG) YCbCr, chroma averaged over 2x2 pixels
+    int w = m_Width, h = m_Height;
+    unsigned char* yPlane = new unsigned char[w*h + 2*(w/2)*(h/2)];
+    unsigned char* cbPlane = yPlane + w*h;
+    unsigned char* crPlane = cbPlane + (w/2)*(h/2);
+    for (int y = 0; y < h; ++y) {
+        const unsigned char* p = pixels + rowSize*(h - 1 - y);
+        unsigned char* q = yPlane + w*y;
+        for (int x = 0; x < w; ++x, p += 3)
+            q[x] = clampByte(0.299*p[0] + 0.587*p[1] + 0.114*p[2]);
+    }
+    for (int y = 0; y < h/2; ++y) {
+        const unsigned char* p0 = pixels + rowSize*(h - 1 - 2*y);
+        const unsigned char* p1 = p0 - rowSize;
+        for (int x = 0; x < w/2; ++x, p0 += 6, p1 += 6) {
+            double r = (p0[0] + p0[3] + p1[0] + p1[3]) / 4.;
+            double g = (p0[1] + p0[4] + p1[1] + p1[4]) / 4.;
+            double b = (p0[2] + p0[5] + p1[2] + p1[5]) / 4.;
+            cbPlane[(w/2)*y + x] =
+                clampByte(128. - 0.168736*r - 0.331264*g + 0.5*b);
+            crPlane[(w/2)*y + x] =
+                clampByte(128. + 0.5*r - 0.418688*g - 0.081312*b);
+        }
+    }
+    fprintf(m_Stream, "FRAME\n");
+    fwrite(yPlane, 1, w*h + 2*(w/2)*(h/2), m_Stream);
+    delete[] yPlane;
+}
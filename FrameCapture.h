@@ -0,0 +1,109 @@
+//
+// File "FrameCapture.h"
+//
+// The definition of the class FrameCapture, that records the frames
+// rendered by OpenGL without stalling the render loop.
+//
+// The frame buffer is read into a ring of pixel buffer objects:
+// glReadPixels() into a PBO only starts a transfer, and the PBO is
+// mapped a few frames later, when the transfer has completed. The
+// pixels are copied into a queue of frames, that is written to disk
+// by a separate writer thread. If the writer falls behind and the
+// queue is full, the frame is dropped and counted.
+//
+// The output is either a sequence of PPM files (the file name
+// is a printf-like pattern, e.g. "frame%05d.ppm", see validPattern())
+// or a raw YUV4MPEG2 stream (the file name ends with ".y4m"), that
+// can be played or encoded by mplayer, ffmpeg etc.
+//
+#ifndef _FRAME_CAPTURE_H
+#define _FRAME_CAPTURE_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <GL/gl.h>
+
+class FrameCapture {
+public:
+    enum Format {
+        PPM_SEQUENCE,
+        Y4M_STREAM
+    };
+
+    // Data members
+private:
+    Format          m_Format;
+    char            m_FileName[256];    // Name or pattern of output files
+    int             m_Width;
+    int             m_Height;
+    int             m_FramesPerSecond;  // Written to the Y4M header
+    bool            m_Active;
+    FILE*           m_Stream;           // Y4M output
+
+    // Ring of pixel buffer objects
+    int             m_NumBuffers;
+    GLuint*         m_Buffers;
+    int             m_NextBuffer;       // PBO for the next frame
+    int             m_PendingBuffers;   // PBOs with transfers in progress
+
+    // Queue of frames for the writer thread
+    int             m_QueueLength;
+    unsigned char** m_Queue;
+    int             m_QueueHead;        // The oldest frame to be written
+    int             m_QueueSize;        // Frames in the queue
+
+    pthread_t       m_Writer;
+    mutable pthread_mutex_t m_Mutex;
+    pthread_cond_t  m_Cond;
+    bool            m_Terminate;
+
+    // Statistics
+    int             m_FramesCaptured;
+    int             m_FramesWritten;
+    int             m_FramesDropped;
+
+    // Methods
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    // Start recording the frames of size width*height.
+    // The OpenGL context, that will be captured, must be current.
+    bool start(
+        const char* fileName,
+        int width, int height,
+        int framesPerSecond = 25,
+        int numBuffers = 3,
+        int queueLength = 8
+    );
+
+    // Read the current frame: call it after the frame is drawn,
+    // before the buffers are swapped
+    void captureFrame();
+
+    // Write the remaining frames and close the output
+    void stop();
+
+    bool active() const         { return m_Active; }
+    int framesCaptured() const  { return m_FramesCaptured; }
+    int framesWritten() const;
+    int framesDropped() const   { return m_FramesDropped; }
+
+    // A pattern of file names may contain at most one conversion
+    // "%d" (with the flag 0 and a width of up to 2 digits, e.g. "%04d")
+    // and any "%%"; other patterns would make snprintf read arguments
+    // that are not passed
+    static bool validPattern(const char* pattern);
+
+private:
+    FrameCapture(const FrameCapture&);              // Not implemented
+    FrameCapture& operator=(const FrameCapture&);   // Not implemented
+
+    int frameSize() const { return 3 * m_Width * m_Height; }
+    void retrieveFrame();       // Map the oldest pending PBO
+    void writerLoop();
+    void writeFrame(const unsigned char* pixels, int frameNumber);
+    static void* writerProc(void* capture);
+};
+
+#endif /* _FRAME_CAPTURE_H */
@@ -0,0 +1,111 @@
+//
+// File "FramePacer.cpp"
+// Implementation of the class FramePacer
+//
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include "FramePacer.h"
+
+const double FramePacer::IDLE_INTERVAL = 0.25;
+
+FramePacer::FramePacer():
+    m_Period(0.),
+    m_Deadline(0.),
+    m_DeadlineValid(false),
+    m_LastFrame(0.),
+    m_LastFrameValid(false),
+    m_SquaredDeviations(0.)
+{
+    resetStats();
+}
+
+double FramePacer::currentTime() {
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double) t.tv_sec + (double) t.tv_nsec * 1e-9;
+}
+
+void FramePacer::setFrameRate(double fps) {
+    m_Period = (fps > 0.)? 1. / fps : 0.;
+    m_DeadlineValid = false;
+}
+
+double FramePacer::frameRate() const {
+    return (m_Period > 0.)? 1. / m_Period : 0.;
+}
+
+double FramePacer::idleInterval() const {
+    return (4.*m_Period > IDLE_INTERVAL)? 4.*m_Period : IDLE_INTERVAL;
+}
+
+void FramePacer::waitDeadline() {
+    if (m_Period <= 0.)
+        return;
+    double now = currentTime();
+    if (!m_DeadlineValid || now > m_Deadline + idleInterval()) {
+        // The first frame or the first one after a pause
+        m_Deadline = now;
+        m_DeadlineValid = true;
+    } else if (now >= m_Deadline) {
+        // The frame was not ready in time: do not try to catch up
+        if (now > m_Deadline + 0.5*m_Period)
+            ++m_Stats.lateFrames;
+        m_Deadline = now;
+    } else {
+        timespec t;
+        t.tv_sec = (time_t) m_Deadline;
+        t.tv_nsec = (long) ((m_Deadline - (double) t.tv_sec) * 1e9);
+        if (t.tv_nsec >= 1000000000L)
+            t.tv_nsec = 999999999L;
+        while (
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, 0) == EINTR
+        )
+            ;
+    }
+    m_Deadline += m_Period;
+}
+
+//
+// The mean and variance are updated by the Welford's method,
+// that does not lose precision on long runs
+//
+void FramePacer::frameShown() {
+    double now = currentTime();
+    if (m_LastFrameValid) {
+        double dt = now - m_LastFrame;
+        if (dt <= idleInterval()) {
+            int n = ++m_Stats.frames;
+            double delta = dt - m_Stats.mean;
+            m_Stats.mean += delta / n;
+            m_SquaredDeviations += delta * (dt - m_Stats.mean);
+            m_Stats.variance = (n > 1)? m_SquaredDeviations / (n - 1) : 0.;
+            if (n == 1 || dt < m_Stats.minimum)
+                m_Stats.minimum = dt;
+            if (n == 1 || dt > m_Stats.maximum)
+                m_Stats.maximum = dt;
+        }
+    }
+    m_LastFrame = now;
+    m_LastFrameValid = true;
+}
+
+void FramePacer::resetStats() {
+    memset(&m_Stats, 0, sizeof(m_Stats));
+    m_SquaredDeviations = 0.;
+    m_LastFrameValid = false;
+}
+
+void printFrameTimeStats(const FrameTimeStats& stats) {
+    if (stats.frames == 0)
+        return;
+    printf(
+        "Frame time: mean %.2f ms, std. deviation %.2f ms, "
+        "min %.2f ms, max %.2f ms, %d late of %d\n",
+        stats.mean * 1000., sqrt(stats.variance) * 1000.,
+        stats.minimum * 1000., stats.maximum * 1000.,
+        stats.lateFrames, stats.frames
+    );
+}
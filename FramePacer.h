@@ -0,0 +1,79 @@
+//
+// File "FramePacer.h"
+//
+// The definition of the class FramePacer, that keeps the frames of
+// a window at a constant rate and measures how regular they are.
+//
+// Before a frame is shown, waitDeadline() sleeps until the moment
+// of the frame, measured by the monotonic clock with nanosecond
+// resolution (clock_nanosleep with an absolute deadline, so the
+// sleep does not accumulate errors). The deadlines advance by the
+// period from each other, not from the moment of the wakeup.
+// If a frame comes after its deadline, the schedule is restarted
+// from now, and the frame is counted as late if it missed the
+// deadline by more than a half of the period; a frame that comes
+// after a long pause (the window had nothing to draw) is not.
+//
+// frameShown() registers the intervals between the frames: their
+// mean, variance, minimum and maximum. Intervals longer than
+// IDLE_INTERVAL (or 4 periods) are pauses, not frames, and are not
+// counted.
+//
+#ifndef _FRAME_PACER_H
+#define _FRAME_PACER_H
+
+// Statistics of the intervals between frames, in seconds
+struct FrameTimeStats {
+    int     frames;         // Intervals measured
+    double  mean;
+    double  variance;
+    double  minimum;
+    double  maximum;
+    int     lateFrames;     // Frames that missed their deadline
+};
+
+// Print the statistics in milliseconds to stdout (nothing, if no
+// frames were measured)
+void printFrameTimeStats(const FrameTimeStats& stats);
+
+class FramePacer {
+public:
+    static const double IDLE_INTERVAL;      // 0.25 sec
+
+    // Data members
+private:
+    double          m_Period;       // 0 means that frames are not paced
+    double          m_Deadline;     // Moment of the next frame
+    bool            m_DeadlineValid;
+    double          m_LastFrame;    // Moment the last frame was shown
+    bool            m_LastFrameValid;
+
+    FrameTimeStats  m_Stats;
+    double          m_SquaredDeviations;    // Sum, for the variance
+
+    // Methods
+public:
+    FramePacer();
+
+    // fps <= 0 turns the pacing off
+    void setFrameRate(double fps);
+    double frameRate() const;
+    double period() const { return m_Period; }
+
+    // Sleep until the moment of the next frame
+    void waitDeadline();
+
+    // Register the moment a frame is shown
+    void frameShown();
+
+    const FrameTimeStats& stats() const { return m_Stats; }
+    void resetStats();
+
+    // Time by the monotonic clock, in seconds
+    static double currentTime();
+
+private:
+    double idleInterval() const;
+};
+
+#endif /* _FRAME_PACER_H */
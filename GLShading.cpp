@@ -0,0 +1,281 @@
+//
+// File "GLShading.cpp"
+// Implementation of the class GLShading
+//
+#define GL_GLEXT_PROTOTYPES     // Shaders and uniform buffers
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GLShading.h"
+#include <GL/glext.h>
+
+// Binding points of the uniform blocks
+static const GLuint LIGHT_BINDING = 0;
+static const GLuint MATERIAL_BINDING = 1;
+
+static const int RING_SLOTS = 64;       // Slots in a uniform buffer
+
+static const char* versionSource = "#version 150 compatibility\n";
+
+static const char* vertexShaderSource =
+    "out vec3 eyePosition;\n"
+    "out vec3 eyeNormal;\n"
+    "out vec4 vertexColor;\n"
+    "void main() {\n"
+    "    vec4 p = gl_ModelViewMatrix * gl_Vertex;\n"
+    "    eyePosition = p.xyz / p.w;\n"
+    "    eyeNormal = gl_NormalMatrix * gl_Normal;\n"
+    "    vertexColor = gl_Color;\n"
+    "    gl_Position = gl_ProjectionMatrix * p;\n"
+    "}\n";
+
+// The same equations as the fixed-function lighting with the
+// infinite viewer: the color of a point with the unit normal n
+static const char* lightingSource =
+    "layout(std140) uniform Light {\n"
+    "    vec4 position;\n"
+    "    vec4 ambient;\n"
+    "    vec4 diffuse;\n"
+    "    vec4 specular;\n"
+    "    vec4 modelAmbient;\n"
+    "} light;\n"
+    "layout(std140) uniform Material {\n"
+    "    vec4 color;\n"
+    "    vec4 specular;\n"
+    "    vec4 shininess;\n"
+    "} material;\n"
+    "vec4 shade(vec3 n, vec3 eyePosition, vec4 vertexColor) {\n"
+    "    vec3 l = normalize(\n"
+    "        light.position.xyz - light.position.w * eyePosition\n"
+    "    );\n"
+    "    vec4 c = material.color * vertexColor;\n"
+    "    float d = max(dot(n, l), 0.);\n"
+    "    vec3 rgb = (light.modelAmbient.rgb + light.ambient.rgb) * c.rgb\n"
+    "        + light.diffuse.rgb * c.rgb * d;\n"
+    "    if (d > 0.) {\n"
+    "        vec3 h = normalize(l + vec3(0., 0., 1.));\n"
+    "        rgb += light.specular.rgb * material.specular.rgb *\n"
+    "            pow(max(dot(n, h), 0.), material.shininess.x);\n"
+    "    }\n"
+    "    return vec4(rgb, c.a);\n"
+    "}\n";
+
+// Two-sided lighting
+static const char* fragmentShaderSource =
+    "in vec3 eyePosition;\n"
+    "in vec3 eyeNormal;\n"
+    "in vec4 vertexColor;\n"
+    "out vec4 fragColor;\n"
+    "void main() {\n"
+    "    vec3 n = normalize(eyeNormal);\n"
+    "    if (!gl_FrontFacing)\n"
+    "        n = -n;\n"
+    "    fragColor = shade(n, eyePosition, vertexColor);\n"
+    "}\n";
+
+static void setVector(
+    GLfloat v[4], GLfloat x, GLfloat y, GLfloat z, GLfloat w
+) {
+    v[0] = x; v[1] = y; v[2] = z; v[3] = w;
+}
+
+GLShading::GLShading():
+    m_Program(0),
+    m_LightBuffer(0),
+    m_MaterialBuffer(0),
+    m_LightSlot(0),
+    m_MaterialSlot(0),
+    m_SlotSize(0),
+    m_Updates(0),
+    m_SkippedUpdates(0)
+{
+    // The defaults of GLWindow::initializeOpenGL()
+    // and of the fixed-function material
+    setVector(m_Light.position, 0., 0., 1., 0.);
+    setVector(m_Light.ambient, 0.25, 0.25, 0.25, 1.);
+    setVector(m_Light.diffuse, 1., 1., 1., 1.);
+    setVector(m_Light.specular, 1., 1., 1., 1.);
+    setVector(m_Light.modelAmbient, 0.2, 0.2, 0.2, 1.);
+
+    setVector(m_Material.color, 0.8, 0.8, 0.8, 1.);
+    setVector(m_Material.specular, 0., 0., 0., 1.);
+    setVector(m_Material.shininess, 0., 0., 0., 0.);
+}
+
+GLShading::~GLShading() {
+    destroy();
+}
+
+bool GLShading::supported() {
+    const char* version = (const char*) glGetString(GL_VERSION);
+    if (version == 0)
+        return false;
+    int major = 0, minor = 0;
+    if (sscanf(version, "%d.%d", &major, &minor) < 2)
+        return false;
+    return (major > 3 || (major == 3 && minor >= 1));
+}
+
+const char* GLShading::versionShaderSource() {
+    return versionSource;
+}
+
+const char* GLShading::lightingShaderSource() {
+    return lightingSource;
+}
+
+GLuint GLShading::compileShader(GLenum type, const char* source) {
+    return compileShader(type, &source, 1);
+}
+
+GLuint GLShading::compileShader(
+    GLenum type, const char* const* sources, int numSources
+) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, numSources, sources, 0);
+    glCompileShader(shader);
+
+    GLint status = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), 0, log);
+        fprintf(stderr, "Shader compilation failed:\n%s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint GLShading::linkProgram(GLuint vertexShader, GLuint fragmentShader) {
+    if (vertexShader == 0 || fragmentShader == 0) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindFragDataLocation(program, 0, "fragColor");
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);       // Deleted with the program
+    glDeleteShader(fragmentShader);
+
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status) {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), 0, log);
+        fprintf(stderr, "Shader program link failed:\n%s\n", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    GLuint block = glGetUniformBlockIndex(program, "Light");
+    if (block != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, block, LIGHT_BINDING);
+    block = glGetUniformBlockIndex(program, "Material");
+    if (block != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, block, MATERIAL_BINDING);
+    return program;
+}
+
+bool GLShading::create() {
+    destroy();
+
+    const char* vertexSources[2] = { versionSource, vertexShaderSource };
+    const char* fragmentSources[3] = {
+        versionSource, lightingSource, fragmentShaderSource
+    };
+    m_Program = linkProgram(
+        compileShader(GL_VERTEX_SHADER, vertexSources, 2),
+        compileShader(GL_FRAGMENT_SHADER, fragmentSources, 3)
+    );
+    if (m_Program == 0)
+        return false;
+
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment <= 0)
+        alignment = 256;
+    int maxSize = (sizeof(Light) > sizeof(Material))?
+        sizeof(Light) : sizeof(Material);
+    m_SlotSize = ((maxSize + alignment - 1) / alignment) * alignment;
+
+    m_LightBuffer = createRing(LIGHT_BINDING, &m_Light, sizeof(Light));
+    m_MaterialBuffer = createRing(
+        MATERIAL_BINDING, &m_Material, sizeof(Material)
+    );
+    m_LightSlot = 0;
+    m_MaterialSlot = 0;
+
+    use();
+    return true;
+}
+
+void GLShading::destroy() {
+    if (m_Program == 0)
+        return;
+    glUseProgram(0);
+    glDeleteProgram(m_Program);
+    glDeleteBuffers(1, &m_LightBuffer);
+    glDeleteBuffers(1, &m_MaterialBuffer);
+    m_Program = 0;
+    m_LightBuffer = 0;
+    m_MaterialBuffer = 0;
+}
+
+void GLShading::use() {
+    glUseProgram(m_Program);
+}
+
+GLuint GLShading::createRing(GLuint binding, const void* data, int size) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(
+        GL_UNIFORM_BUFFER, RING_SLOTS * m_SlotSize, 0, GL_DYNAMIC_DRAW
+    );
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, 0, size);
+    return buffer;
+}
+
+void GLShading::writeSlot(
+    GLuint buffer, GLuint binding, int& slot,
+    const void* data, int size
+) {
+    slot = (slot + 1) % RING_SLOTS;
+    GLintptr offset = slot * m_SlotSize;
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+    ++m_Updates;
+}
+
+void GLShading::setLight(const Light& light) {
+    if (memcmp(&light, &m_Light, sizeof(Light)) == 0) {
+        ++m_SkippedUpdates;
+        return;
+    }
+    m_Light = light;
+    writeSlot(
+        m_LightBuffer, LIGHT_BINDING, m_LightSlot, &m_Light, sizeof(Light)
+    );
+}
+
+void GLShading::setMaterial(const Material& material) {
+    if (memcmp(&material, &m_Material, sizeof(Material)) == 0) {
+        ++m_SkippedUpdates;
+        return;
+    }
+    m_Material = material;
+    writeSlot(
+        m_MaterialBuffer, MATERIAL_BINDING, m_MaterialSlot,
+        &m_Material, sizeof(Material)
+    );
+}
@@ -0,0 +1,119 @@
+//
+// File "GLShading.h"
+//
+// The definition of the class GLShading, a shader program that
+// replaces the fixed-function lighting of OpenGL: one directional
+// or positional light, two-sided per-pixel lighting with the
+// "ambient and diffuse" material color and optional specular color.
+//
+// The program is compiled once per OpenGL context. Light and
+// material parameters are kept in uniform buffers (blocks "Light"
+// and "Material", std140 layout), that are rewritten only when
+// the parameters really change, so a frame costs a few small
+// uniform updates instead of a dozen glLight/glMaterial calls.
+// Each buffer is a ring of slots: a new value goes to the next slot,
+// that is then bound with glBindBufferRange. So the slot used by
+// the previous draw calls is never overwritten, and the driver
+// neither waits for them nor mixes up the vertices of glBegin/glEnd
+// not yet sent to the GPU.
+//
+// Other programs (see SphereImpostors.h) may use the same uniform
+// blocks: their shaders begin with versionShaderSource(), the #version
+// line, and the fragment shaders include lightingShaderSource(), that
+// declares the blocks and the function
+//     vec4 shade(vec3 n, vec3 eyePosition, vec4 vertexColor)
+// returning the lit color of a point with the unit eye-space normal n,
+// and they are linked by linkProgram(), that binds the blocks.
+//
+// The shaders use GLSL 1.50 in the compatibility profile, so the
+// vertices may still be given by glBegin/glEnd, vertex arrays or GLU.
+// The vertex color (glColor) multiplies the material color.
+// OpenGL 3.1 (uniform buffer objects) is required; for older
+// contexts GLWindow keeps the fixed-function path.
+//
+#ifndef _GL_SHADING_H
+#define _GL_SHADING_H
+
+#include <GL/gl.h>
+
+class GLShading {
+public:
+    // Uniform blocks, std140 layout: every member is a vec4
+    struct Light {
+        GLfloat position[4];    // Eye coordinates, w = 0 for directional
+        GLfloat ambient[4];
+        GLfloat diffuse[4];
+        GLfloat specular[4];
+        GLfloat modelAmbient[4];    // Global ambient light
+    };
+    struct Material {
+        GLfloat color[4];       // Ambient and diffuse
+        GLfloat specular[4];
+        GLfloat shininess[4];   // shininess[0] is used
+    };
+
+    // Data members
+private:
+    GLuint      m_Program;
+    GLuint      m_LightBuffer;
+    GLuint      m_MaterialBuffer;
+    int         m_LightSlot;        // Current slots of the rings
+    int         m_MaterialSlot;
+    int         m_SlotSize;         // Multiple of the offset alignment
+
+    Light       m_Light;        // Current contents of uniform buffers
+    Material    m_Material;
+
+    // Statistics
+    int         m_Updates;      // Uniform buffer updates
+    int         m_SkippedUpdates;   // Calls that changed nothing
+
+    // Methods
+public:
+    GLShading();
+    ~GLShading();
+
+    // Does the current context support the shader path?
+    static bool supported();
+
+    // Compile the program in the current context, create the uniform
+    // buffers and bind them. Returns false if compilation fails.
+    bool create();
+    void destroy();
+    bool created() const { return (m_Program != 0); }
+
+    // Make the program current
+    void use();
+
+    void setLight(const Light& light);
+    void setMaterial(const Material& material);
+
+    const Light& light() const          { return m_Light; }
+    const Material& material() const    { return m_Material; }
+
+    int updates() const         { return m_Updates; }
+    int skippedUpdates() const  { return m_SkippedUpdates; }
+
+    // Helpers for programs using the same light and material.
+    // Compilation and link errors are printed to stderr, 0 is returned.
+    static const char* versionShaderSource();   // The first source
+    static const char* lightingShaderSource();
+    static GLuint compileShader(GLenum type, const char* source);
+    static GLuint compileShader(
+        GLenum type, const char* const* sources, int numSources
+    );
+    // Link and delete the shaders, bind the uniform blocks
+    static GLuint linkProgram(GLuint vertexShader, GLuint fragmentShader);
+
+private:
+    GLShading(const GLShading&);                // Not implemented
+    GLShading& operator=(const GLShading&);     // Not implemented
+
+    GLuint createRing(GLuint binding, const void* data, int size);
+    void writeSlot(
+        GLuint buffer, GLuint binding, int& slot,
+        const void* data, int size
+    );
+};
+
+#endif /* _GL_SHADING_H */
@@ -1,11 +1,24 @@
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "GLWindow.h"
+#include <EGL/eglext.h>
 
 // static class members
 XVisualInfo* GLWindow::gl_visual = 0;
 bool GLWindow::gl_swap_flag = false;
 
+bool GLWindow::gl_offscreen = false;
+EGLDisplay GLWindow::gl_egl_display = EGL_NO_DISPLAY;
+EGLConfig GLWindow::gl_egl_config = 0;
+int GLWindow::gl_offscreen_frames = 1;
+const char* GLWindow::gl_offscreen_output = 0;
+
+GLWindow* GLWindow::gl_first_window = 0;
+GLWindow* GLWindow::gl_current_window = 0;
+FramePacer GLWindow::gl_scheduler_pacer;
+const double GLWindow::RESIZE_SETTLE_TIME = 0.1;
+
 // Static methods
 
 static int attributeListDbl[] = {
@@ -42,6 +55,89 @@ void GLWindow::selectGLVisual() {
     }
 }
 
+static const EGLint offscreenConfigAttributes[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+    EGL_DEPTH_SIZE, 16,
+    EGL_NONE
+};
+
+bool GLWindow::initGraphics() {
+    const char* backend = getenv("GLWINDOW_BACKEND");
+    const char* display = getenv("DISPLAY");
+    bool forceOffscreen = (
+        backend != 0 && strcmp(backend, "offscreen") == 0
+    );
+    bool forceGLX = (backend != 0 && strcmp(backend, "glx") == 0);
+
+    if (!forceOffscreen && (forceGLX || (display != 0 && *display != 0)))
+        return initX();
+    return initOffscreen();
+}
+
+bool GLWindow::initOffscreen() {
+    // Prefer the Mesa "surfaceless" platform, that needs neither
+    // X server nor GPU device
+    const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = 0;
+    if (
+        extensions != 0 &&
+        strstr(extensions, "EGL_MESA_platform_surfaceless") != 0
+    ) {
+        getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+            eglGetProcAddress("eglGetPlatformDisplayEXT");
+    }
+    if (getPlatformDisplay != 0) {
+        gl_egl_display = getPlatformDisplay(
+            EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0
+        );
+    } else {
+        gl_egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major, minor, numConfigs;
+    if (
+        gl_egl_display == EGL_NO_DISPLAY ||
+        !eglInitialize(gl_egl_display, &major, &minor)
+    ) {
+        fprintf(stderr, "Cannot initialize EGL\n");
+        gl_egl_display = EGL_NO_DISPLAY;
+        return false;
+    }
+    if (
+        !eglBindAPI(EGL_OPENGL_API) ||
+        !eglChooseConfig(
+            gl_egl_display, offscreenConfigAttributes,
+            &gl_egl_config, 1, &numConfigs
+        ) ||
+        numConfigs < 1
+    ) {
+        fprintf(stderr, "No EGL configuration for offscreen OpenGL\n");
+        eglTerminate(gl_egl_display);
+        gl_egl_display = EGL_NO_DISPLAY;
+        return false;
+    }
+
+    const char* frames = getenv("GLWINDOW_FRAMES");
+    if (frames != 0)
+        gl_offscreen_frames = atoi(frames);
+    gl_offscreen_output = getenv("GLWINDOW_OUTPUT");
+    if (
+        gl_offscreen_output != 0 &&
+        !FrameCapture::validPattern(gl_offscreen_output)
+    ) {
+        fprintf(
+            stderr, "GLWINDOW_OUTPUT: invalid pattern %s, no files\n",
+            gl_offscreen_output
+        );
+        gl_offscreen_output = 0;
+    }
+
+    gl_offscreen = true;
+    return GWindow::initHeadless();
+}
+
 void GLWindow::initializeOpenGL() {
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_LIGHTING);
@@ -68,24 +164,70 @@ void GLWindow::initializeOpenGL() {
 }
 
 void GLWindow::terminateOpenGL() {
-
+    if (gl_offscreen && gl_egl_display != EGL_NO_DISPLAY) {
+        eglMakeCurrent(
+            gl_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT
+        );
+        eglTerminate(gl_egl_display);
+        gl_egl_display = EGL_NO_DISPLAY;
+    }
 }
 
 // constructor, destructor
 GLWindow::GLWindow():
     GWindow(),
     m_GLXContext(),
-    m_GLXContextCreated(false)
+    m_GLXContextCreated(false),
+    m_EGLContext(EGL_NO_CONTEXT),
+    m_EGLSurface(EGL_NO_SURFACE),
+    m_FrameCount(0),
+    m_Capture(0),
+    m_Pacer(),
+    m_SwapInterval(0),
+    m_DynamicResolution(0),
+    m_Shading(0),
+    m_SphereImpostors(0),
+    m_MaterialShininess(0.),
+    m_MaterialValid(false),
+    m_RenderQueue(this),
+    m_ProjectionRect(),
+    m_ProjectionValid(false),
+    m_ResizePending(false),
+    m_ResizeTime(0.)
 {
     memset(&m_GLXContext, 0, sizeof(m_GLXContext));
+    memset(m_Projection, 0, sizeof(m_Projection));
+    m_MaterialColor[0] = 0.8; m_MaterialColor[1] = 0.8;
+    m_MaterialColor[2] = 0.8; m_MaterialColor[3] = 1.;
+    memset(m_MaterialSpecular, 0, sizeof(m_MaterialSpecular));
+    memset(&m_FrameStats, 0, sizeof(m_FrameStats));
+    memset(&m_LastFrameStats, 0, sizeof(m_LastFrameStats));
+
+    m_NextGLWindow = gl_first_window;
+    gl_first_window = this;
 }
 
 GLWindow::~GLWindow()
 {
-    if (m_GLXContextCreated) {
-        glXDestroyContext(m_Display, m_GLXContext);
-        m_GLXContextCreated = false;
+    destroyContext();
+    delete m_Capture;
+
+    GLWindow** p = &gl_first_window;
+    while (*p != this)
+        p = &((*p)->m_NextGLWindow);
+    *p = m_NextGLWindow;
+}
+
+// Any other window that has a context: all contexts
+// are in the same share group
+GLWindow* GLWindow::shareWindow() const {
+    for (GLWindow* w = gl_first_window; w != 0; w = w->m_NextGLWindow) {
+        if (w == this)
+            continue;
+        if (w->m_GLXContextCreated || w->m_EGLContext != EGL_NO_CONTEXT)
+            return w;
     }
+    return 0;
 }
 
 void GLWindow::createWindow(
@@ -95,7 +237,7 @@ void GLWindow::createWindow(
     unsigned long attributesValueMask,  // which attributes are defined
     XSetWindowAttributes* attributes    // attributes structure
 ) {
-    if (gl_visual == 0)
+    if (gl_visual == 0 && !gl_offscreen)
         selectGLVisual();
 
     GWindow::createWindow(
@@ -105,28 +247,31 @@ void GLWindow::createWindow(
         attributesValueMask, attributes
     );
 
-    createGLXContext();
+    if (gl_offscreen)
+        createOffscreenContext();
+    else
+        createGLXContext();
     makeCurrent();
+    initShading();
 
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    // a perspective-view matrix...
+    const char* captureName = getenv("GLWINDOW_CAPTURE");
+    if (captureName != 0 && *captureName != 0)
+        startCapture(captureName);
+    const char* budget = getenv("GLWINDOW_DYNAMIC_RESOLUTION");
+    if (budget != 0 && atof(budget) > 0.)
+        setDynamicResolution(atof(budget) / 1000.);
 
     int w = m_IWinRect.width();
     int h = m_IWinRect.height();
 
     glViewport(0, 0, w, h);
+    loadProjection();
 
+    // a perspective-view matrix...
+    /*
     double depth = m_RWinRect.width();
     if (m_RWinRect.height() > depth)
         depth = m_RWinRect.height();
-    glOrtho(
-        m_RWinRect.left(), m_RWinRect.right(),  // left, right
-        m_RWinRect.bottom(), m_RWinRect.top(),  // bottom, top,
-        -10. * depth, 10. * depth               // near, far
-    );
-
-    /*
     double aspect = m_RWinRect.width() / m_RWinRect.height();
     gluPerspective(
         30.0,           // Field-of-view angle
@@ -226,40 +371,542 @@ void GLWindow::createWindow(
 void GLWindow::createGLXContext() {
     if (gl_visual == 0)
         selectGLVisual();
+    GLWindow* share = shareWindow();
     m_GLXContext = glXCreateContext(
-        m_Display, gl_visual, 0, GL_TRUE
+        m_Display, gl_visual,
+        (share != 0)? share->m_GLXContext : 0,
+        GL_TRUE
+    );
+    m_GLXContextCreated = (m_GLXContext != 0);
+}
+
+// The offscreen window is a pbuffer of the size of window
+void GLWindow::createOffscreenContext() {
+    EGLint surfaceAttributes[] = {
+        EGL_WIDTH, m_IWinRect.width(),
+        EGL_HEIGHT, m_IWinRect.height(),
+        EGL_NONE
+    };
+    m_EGLSurface = eglCreatePbufferSurface(
+        gl_egl_display, gl_egl_config, surfaceAttributes
     );
+    GLWindow* share = shareWindow();
+    m_EGLContext = eglCreateContext(
+        gl_egl_display, gl_egl_config,
+        (share != 0)? share->m_EGLContext : EGL_NO_CONTEXT,
+        0
+    );
+    if (m_EGLSurface == EGL_NO_SURFACE || m_EGLContext == EGL_NO_CONTEXT)
+        fprintf(stderr, "Cannot create an offscreen OpenGL context\n");
+}
+
+void GLWindow::destroyContext() {
+    stopCapture();      // Needs the context
+    if (m_DynamicResolution != 0) {
+        makeCurrent();
+        delete m_DynamicResolution;
+        m_DynamicResolution = 0;
+    }
+    if (m_SphereImpostors != 0) {
+        makeCurrent();
+        delete m_SphereImpostors;
+        m_SphereImpostors = 0;
+    }
+    if (m_Shading != 0) {
+        makeCurrent();
+        delete m_Shading;
+        m_Shading = 0;
+    }
+    if (gl_current_window == this) {
+        if (m_GLXContextCreated) {
+            glXMakeCurrent(m_Display, None, 0);
+        } else if (m_EGLContext != EGL_NO_CONTEXT) {
+            eglMakeCurrent(
+                gl_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT
+            );
+        }
+        gl_current_window = 0;
+    }
+    if (m_GLXContextCreated) {
+        glXDestroyContext(m_Display, m_GLXContext);
+        m_GLXContextCreated = false;
+    }
+    if (m_EGLContext != EGL_NO_CONTEXT || m_EGLSurface != EGL_NO_SURFACE) {
+        if (m_EGLContext != EGL_NO_CONTEXT)
+            eglDestroyContext(gl_egl_display, m_EGLContext);
+        if (m_EGLSurface != EGL_NO_SURFACE)
+            eglDestroySurface(gl_egl_display, m_EGLSurface);
+        m_EGLContext = EGL_NO_CONTEXT;
+        m_EGLSurface = EGL_NO_SURFACE;
+    }
 }
 
+//
+// In the offscreen mode the frame is written to a file, if
+// GLWINDOW_OUTPUT is defined, and the window is closed after
+// GLWINDOW_FRAMES frames
+//
 void GLWindow::swapBuffers() {
+    m_LastFrameStats = m_FrameStats;
+    memset(&m_FrameStats, 0, sizeof(m_FrameStats));
+
+    // The frame is upscaled into the window buffer, so that
+    // the capture and the output files have the full size
+    if (m_DynamicResolution != 0 && !m_ResizePending)
+        m_DynamicResolution->present();
+
+    if (m_Capture != 0 && m_Capture->active())
+        m_Capture->captureFrame();
     glFlush();
+
+    // With the swap control glXSwapBuffers waits for the retrace,
+    // a deferred redraw is paced by the scheduler
+    if (!redrawDeferred() && m_SwapInterval == 0)
+        m_Pacer.waitDeadline();
+    if (gl_offscreen) {
+        m_Pacer.frameShown();
+        ++m_FrameCount;
+        if (gl_offscreen_output != 0) {
+            char fileName[256];
+            snprintf(
+                fileName, sizeof(fileName),
+                gl_offscreen_output, m_FrameCount
+            );
+            writePPM(fileName);
+        }
+        restoreRenderTarget();
+        if (gl_offscreen_frames > 0 && m_FrameCount >= gl_offscreen_frames)
+            destroyWindow();
+        return;
+    }
     if (gl_swap_flag)
         glXSwapBuffers(m_Display, m_Window);
+    m_Pacer.frameShown();
+    restoreRenderTarget();
+}
+
+void GLWindow::restoreRenderTarget() {
+    if (m_DynamicResolution == 0)
+        return;
+    if (m_ResizePending) {
+        if (FramePacer::currentTime() - m_ResizeTime < RESIZE_SETTLE_TIME)
+            return;             // Still resizing: stay at full resolution
+        m_ResizePending = false;
+        if (!m_DynamicResolution->resize(
+            m_IWinRect.width(), m_IWinRect.height()
+        )) {
+            delete m_DynamicResolution;
+            m_DynamicResolution = 0;
+            return;
+        }
+    }
+    m_DynamicResolution->bind();
+}
+
+//
+// Swap control extensions, in the order of preference.
+// The functions are looked up at runtime, because the headers
+// of the system do not always declare them.
+//
+typedef void (*SwapIntervalEXTProc)(Display*, GLXDrawable, int);
+typedef int (*SwapIntervalMESAProc)(unsigned int);
+typedef int (*SwapIntervalSGIProc)(int);
+
+static bool hasGLXExtension(Display* display, int screen, const char* name) {
+    const char* extensions = glXQueryExtensionsString(display, screen);
+    if (extensions == 0)
+        return false;
+    int len = (int) strlen(name);
+    const char* p = extensions;
+    while ((p = strstr(p, name)) != 0) {
+        if (
+            (p == extensions || p[-1] == ' ') &&
+            (p[len] == 0 || p[len] == ' ')
+        )
+            return true;
+        p += len;
+    }
+    return false;
+}
+
+bool GLWindow::setSwapInterval(int interval) {
+    if (gl_offscreen || !m_GLXContextCreated)
+        return false;
+    makeCurrent();
+    if (hasGLXExtension(m_Display, m_Screen, "GLX_EXT_swap_control")) {
+        SwapIntervalEXTProc swapInterval = (SwapIntervalEXTProc)
+            glXGetProcAddressARB((const GLubyte*) "glXSwapIntervalEXT");
+        if (swapInterval != 0) {
+            swapInterval(m_Display, m_Window, interval);
+            return true;
+        }
+    }
+    if (hasGLXExtension(m_Display, m_Screen, "GLX_MESA_swap_control")) {
+        SwapIntervalMESAProc swapInterval = (SwapIntervalMESAProc)
+            glXGetProcAddressARB((const GLubyte*) "glXSwapIntervalMESA");
+        if (swapInterval != 0)
+            return (swapInterval((unsigned int) interval) == 0);
+    }
+    if (
+        interval > 0 &&         // SGI extension cannot turn it off
+        hasGLXExtension(m_Display, m_Screen, "GLX_SGI_swap_control")
+    ) {
+        SwapIntervalSGIProc swapInterval = (SwapIntervalSGIProc)
+            glXGetProcAddressARB((const GLubyte*) "glXSwapIntervalSGI");
+        if (swapInterval != 0)
+            return (swapInterval(interval) == 0);
+    }
+    return false;
+}
+
+//
+// With the swap control, glXSwapBuffers waits for the vertical
+// retrace and keeps the refresh rate of the display; the pacer
+// only measures the frames. Without it (or offscreen) the sleep
+// of the pacer keeps the rate.
+//
+void GLWindow::setFrameRate(double fps) {
+    m_Pacer.setFrameRate(fps);
+    if (fps > 0.) {
+        m_SwapInterval = setSwapInterval(1)? 1 : 0;
+    } else if (m_SwapInterval > 0) {
+        setSwapInterval(0);
+        m_SwapInterval = 0;
+    }
+    m_Pacer.resetStats();
 }
 
 void GLWindow::makeCurrent() {
-    glXMakeCurrent(m_Display, m_Window, m_GLXContext);
+    if (gl_current_window != this) {
+        gl_current_window = this;
+        if (gl_offscreen) {
+            eglMakeCurrent(
+                gl_egl_display, m_EGLSurface, m_EGLSurface, m_EGLContext
+            );
+        } else {
+            glXMakeCurrent(m_Display, m_Window, m_GLXContext);
+        }
+    }
+
+    // A frame usually begins here: restore the reduced viewport,
+    // in case the drawing code has set the full one
+    if (m_DynamicResolution != 0 && !m_ResizePending)
+        m_DynamicResolution->bind();
+}
+
+bool GLWindow::setDynamicResolution(double budget) {
+    makeCurrent();
+    if (budget <= 0.) {
+        delete m_DynamicResolution;
+        m_DynamicResolution = 0;
+        glDisable(GL_SCISSOR_TEST);
+        glViewport(0, 0, m_IWinRect.width(), m_IWinRect.height());
+        return true;
+    }
+    if (m_DynamicResolution != 0) {
+        m_DynamicResolution->setBudget(budget);
+        return true;
+    }
+    if (!DynamicResolution::supported())
+        return false;
+    m_DynamicResolution = new DynamicResolution(budget);
+    if (!m_DynamicResolution->resize(
+        m_IWinRect.width(), m_IWinRect.height()
+    )) {
+        delete m_DynamicResolution;
+        m_DynamicResolution = 0;
+        return false;
+    }
+    m_ResizePending = false;
+    m_DynamicResolution->bind();
+    return true;
+}
+
+int GLWindow::renderDirtyWindows() {
+    int numDirty = 0;
+    GLWindow* w;
+    for (w = gl_first_window; w != 0; w = w->m_NextGLWindow) {
+        if (w->redrawDeferred() && w->redrawPending())
+            ++numDirty;
+    }
+    if (numDirty == 0)
+        return 0;
+
+    gl_scheduler_pacer.waitDeadline();      // One wait for all windows
+    int numDrawn = 0;
+    w = gl_first_window;
+    while (w != 0) {
+        // onExpose may destroy the window (offscreen frame limit)
+        GLWindow* next = w->m_NextGLWindow;
+        if (
+            w->redrawDeferred() && w->redrawPending() &&
+            w->windowCreated()
+        ) {
+            w->clearRedrawPending();
+            w->makeCurrent();
+
+            XEvent e;
+            memset(&e, 0, sizeof(e));
+            e.type = Expose;
+            e.xany.window = w->m_Window;
+            e.xexpose.width = w->m_IWinRect.width();
+            e.xexpose.height = w->m_IWinRect.height();
+            e.xexpose.count = 0;
+            w->onExpose(e);
+            ++numDrawn;
+        }
+        w = next;
+    }
+    gl_scheduler_pacer.frameShown();
+    return numDrawn;
+}
+
+bool GLWindow::writePPM(const char* fileName) {
+    int w = m_IWinRect.width();
+    int h = m_IWinRect.height();
+    unsigned char* pixels = new unsigned char[3*w*h];
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+
+    FILE* f = fopen(fileName, "wb");
+    if (f == 0) {
+        perror("Cannot open a frame file");
+        delete[] pixels;
+        return false;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", w, h);
+    for (int y = h - 1; y >= 0; --y)        // OpenGL rows go up
+        fwrite(pixels + 3*w*y, 1, 3*w, f);
+    fclose(f);
+    delete[] pixels;
+    return true;
+}
+
+void GLWindow::initShading() {
+    m_MaterialValid = false;
+    const char* shaders = getenv("GLWINDOW_SHADERS");
+    bool useShaders = (
+        (shaders == 0 || strcmp(shaders, "0") != 0) &&
+        GLShading::supported()
+    );
+    if (useShaders) {
+        m_Shading = new GLShading();
+        if (!m_Shading->create()) {
+            delete m_Shading;   // Use the fixed-function lighting
+            m_Shading = 0;
+        }
+    }
+    if (m_Shading == 0) {
+        // The ambient and diffuse colors of material follow glColor,
+        // that is much cheaper than glMaterial for per-vertex colors
+        glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+        glEnable(GL_COLOR_MATERIAL);
+        glColor4fv(m_MaterialColor);
+    }
+}
+
+SphereImpostors* GLWindow::sphereImpostors() {
+    if (m_Shading == 0)
+        return 0;
+    if (m_SphereImpostors == 0) {
+        m_SphereImpostors = new SphereImpostors();
+        if (!m_SphereImpostors->create()) {
+            delete m_SphereImpostors;
+            m_SphereImpostors = 0;
+        }
+    }
+    return m_SphereImpostors;
+}
+
+void GLWindow::setLight(
+    const GLfloat position[4],
+    const GLfloat ambient[4],
+    const GLfloat diffuse[4],
+    const GLfloat specular[4]
+) {
+    if (m_Shading == 0) {
+        glLightfv(GL_LIGHT0, GL_POSITION, position);
+        glLightfv(GL_LIGHT0, GL_AMBIENT, ambient);
+        glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuse);
+        glLightfv(GL_LIGHT0, GL_SPECULAR, specular);
+        return;
+    }
+
+    // Eye coordinates of the light position
+    GLfloat m[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, m);
+    GLShading::Light light = m_Shading->light();
+    for (int i = 0; i < 4; ++i) {
+        light.position[i] =
+            m[i]*position[0] + m[4 + i]*position[1] +
+            m[8 + i]*position[2] + m[12 + i]*position[3];
+        light.ambient[i] = ambient[i];
+        light.diffuse[i] = diffuse[i];
+        light.specular[i] = specular[i];
+    }
+    m_Shading->setLight(light);
 }
 
+void GLWindow::setMaterial(
+    const GLfloat color[4],
+    GLfloat shininess /* = 0. */,
+    const GLfloat* specular /* = 0 */
+) {
+    static const GLfloat noSpecular[4] = { 0., 0., 0., 1. };
+    if (specular == 0)
+        specular = noSpecular;
+    if (
+        m_MaterialValid &&
+        memcmp(m_MaterialColor, color, sizeof(m_MaterialColor)) == 0 &&
+        memcmp(m_MaterialSpecular, specular, 4*sizeof(GLfloat)) == 0 &&
+        m_MaterialShininess == shininess
+    ) {
+        countStateChange(false);
+        return;
+    }
+    countStateChange(true);
+    for (int i = 0; i < 4; ++i) {
+        m_MaterialColor[i] = color[i];
+        m_MaterialSpecular[i] = specular[i];
+    }
+    m_MaterialShininess = shininess;
+    m_MaterialValid = true;
+
+    if (m_Shading == 0) {
+        glColor4fv(color);      // GL_COLOR_MATERIAL is enabled
+        glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, specular);
+        glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, shininess);
+        return;
+    }
+
+    GLShading::Material material;
+    for (int i = 0; i < 4; ++i) {
+        material.color[i] = color[i];
+        material.specular[i] = specular[i];
+        material.shininess[i] = 0.;
+    }
+    material.shininess[0] = shininess;
+    m_Shading->setMaterial(material);
+    glColor4f(1., 1., 1., 1.);
+}
+
+void GLWindow::setVertexColor(const GLfloat color[4]) {
+    // The next setMaterial() must restore the material color
+    m_MaterialValid = false;
+    if (m_Shading != 0) {
+        glColor4fv(color);
+        return;
+    }
+    GLfloat c[4];
+    for (int i = 0; i < 4; ++i)
+        c[i] = m_MaterialColor[i] * color[i];
+    glColor4fv(c);
+}
+
+bool GLWindow::startCapture(
+    const char* fileName, int framesPerSecond /* = 25 */
+) {
+    if (m_Capture == 0)
+        m_Capture = new FrameCapture();
+    makeCurrent();
+    return m_Capture->start(
+        fileName, m_IWinRect.width(), m_IWinRect.height(), framesPerSecond
+    );
+}
+
+void GLWindow::stopCapture() {
+    if (m_Capture == 0 || !m_Capture->active())
+        return;
+    makeCurrent();
+    m_Capture->stop();
+    printf(
+        "Frames captured: %d, written: %d, dropped: %d\n",
+        m_Capture->framesCaptured(), m_Capture->framesWritten(),
+        m_Capture->framesDropped()
+    );
+}
+
+void GLWindow::updateProjection() {
+    const R2Rectangle& r = m_RWinRect;
+    if (
+        m_ProjectionValid &&
+        r.left() == m_ProjectionRect.left() &&
+        r.bottom() == m_ProjectionRect.bottom() &&
+        r.width() == m_ProjectionRect.width() &&
+        r.height() == m_ProjectionRect.height()
+    )
+        return;
+
+    double depth = r.width();
+    if (r.height() > depth)
+        depth = r.height();
+    double zNear = -10. * depth, zFar = 10. * depth;
+
+    // The matrix of glOrtho, column-major
+    memset(m_Projection, 0, sizeof(m_Projection));
+    m_Projection[0] = (GLfloat) (2. / r.width());
+    m_Projection[5] = (GLfloat) (2. / r.height());
+    m_Projection[10] = (GLfloat) (-2. / (zFar - zNear));
+    m_Projection[12] = (GLfloat) (-(r.right() + r.left()) / r.width());
+    m_Projection[13] = (GLfloat) (-(r.top() + r.bottom()) / r.height());
+    m_Projection[14] = (GLfloat) (-(zFar + zNear) / (zFar - zNear));
+    m_Projection[15] = 1.;
+
+    m_ViewVolume.setOrtho(r, zNear, zFar);
+    m_ProjectionRect = r;
+    m_ProjectionValid = true;
+}
+
+void GLWindow::loadProjection() {
+    updateProjection();
+    GLint matrixMode;
+    glGetIntegerv(GL_MATRIX_MODE, &matrixMode);
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(m_Projection);
+    glMatrixMode(matrixMode);
+}
+
+bool GLWindow::visible(const R3Box& box) {
+    GLfloat modelview[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    bool v = m_ViewVolume.visible(modelview, box);
+    countCulling(v);
+    return v;
+}
+
+bool GLWindow::visible(const BoundingSphere& sphere) {
+    GLfloat modelview[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    bool v = m_ViewVolume.visible(modelview, sphere);
+    countCulling(v);
+    return v;
+}
+
+//
+// A window is resized by a stream of ConfigureNotify events. Each one
+// only sets the viewport and the projection (the cached matrix, so
+// the previous projection does not accumulate); the framebuffer object
+// of dynamic resolution is left alone and reallocated after the frame
+// that ends the burst, see restoreRenderTarget().
+//
 void GLWindow::onResize(XEvent& /* event */) {
+    if (m_DynamicResolution != 0) {
+        m_ResizePending = true;
+        m_ResizeTime = FramePacer::currentTime();
+    }
+    makeCurrent();
+    if (m_DynamicResolution != 0)
+        m_DynamicResolution->suspend();
+
     glViewport(
         0, 0, m_IWinRect.width(), m_IWinRect.height()
     );
+    loadProjection();
 
-    double depth = m_RWinRect.width();
-    if (m_RWinRect.height() > depth)
-        depth = m_RWinRect.height();
-    glOrtho(
-        m_RWinRect.left(), m_RWinRect.right(),  // left, right
-        m_RWinRect.bottom(), m_RWinRect.top(),  // bottom, top,
-        -10. * depth, 10. * depth               // near, far
-    );
+    // The picture is redrawn by dispatchEvent in the new size
 }
 
 void GLWindow::destroyWindow() {
-    if (m_GLXContextCreated) {
-        glXDestroyContext(m_Display, m_GLXContext);
-        m_GLXContextCreated = false;
-    }
+    destroyContext();
     GWindow::destroyWindow();
 }
@@ -9,6 +9,62 @@
 //
 // Written by V. Borisenko
 //
+// Two rendering backends are supported:
+//   - GLX: a window on the X display;
+//   - offscreen: an EGL pbuffer rendered by Mesa, no X display needed.
+// GLWindow::initGraphics() selects the offscreen backend when
+// the DISPLAY variable is not set (or GLWINDOW_BACKEND=offscreen).
+// In the offscreen mode the windows are headless (see GWindow), and
+// the following environment variables control the batch rendering:
+//   GLWINDOW_FRAMES  number of frames to render before the window
+//                    is closed (default 1, 0 means no limit);
+//   GLWINDOW_OUTPUT  printf-like name of PPM files for frames,
+//                    for example "frame%04d.ppm" (default: no files);
+//                    at most one "%d" (see FrameCapture::validPattern).
+//
+// Lighting: when the context supports OpenGL 3.1, the window uses
+// a shader program with the light and material parameters in uniform
+// buffers (see GLShading.h); otherwise the fixed-function lighting.
+// The drawing code should set them by setLight(), setMaterial() and
+// setVertexColor(), that work with both paths. GLWINDOW_SHADERS=0
+// forces the fixed-function path. The shader path can also draw
+// many spheres cheaply as impostors (see SphereImpostors.h).
+//
+// Frame pacing: setFrameRate() turns on the vertical synchronization
+// (GLX swap control extensions) where it is available, and
+// swapBuffers() sleeps until the moment of the next frame (see
+// FramePacer.h). frameTimeStats() gives the mean and the variance
+// of the intervals between frames.
+//
+// Dynamic resolution: setDynamicResolution(budget) makes the window
+// render into a framebuffer object at a reduced scale, chosen so that
+// a frame is drawn within the budget, and swapBuffers() upscales it
+// to the window (see DynamicResolution.h). Also enabled by
+//   GLWINDOW_DYNAMIC_RESOLUTION  frame time budget in milliseconds.
+//
+// Resizing: onResize() restores the full viewport and the projection
+// of the window coordinate rectangle (see loadProjection). The render
+// targets of dynamic resolution are reallocated once per resize burst,
+// when ConfigureNotify events have stopped for RESIZE_SETTLE_TIME;
+// until then the frames are drawn into the window at full resolution.
+// The frame capture keeps the size it was started with.
+//
+// Culling: the objects outside the orthographic view volume set up
+// by createWindow() and onResize() may be skipped before they are
+// drawn or submitted to the render queue, see visible() and
+// ViewVolume.h.
+//
+// Several windows may show the same scene: the contexts of all
+// windows are shared (display lists, textures, buffers and shaders
+// created in one window are available in all of them). The windows
+// with deferred redraw (setRedrawDeferred) are drawn together by
+// renderDirtyWindows(), that visits every dirty window once per frame.
+//
+// The frames of a window can be recorded asynchronously (see
+// FrameCapture.h) by startCapture(), or by setting the variable
+//   GLWINDOW_CAPTURE printf-like name of PPM files or name of
+//                    a ".y4m" video file.
+//
 #ifndef _GL_WINDOW_H
 #define _GL_WINDOW_H
 
@@ -17,6 +73,23 @@
 #include <GL/glx.h> 
 #include <GL/gl.h> 
 #include <GL/glu.h>
+#include <EGL/egl.h>
+
+#include "DynamicResolution.h"
+#include "FrameCapture.h"
+#include "FramePacer.h"
+#include "GLShading.h"
+#include "RenderQueue.h"
+#include "SphereImpostors.h"
+#include "ViewVolume.h"
+
+// Numbers of state changes and culled objects in a frame
+struct RenderStats {
+    int stateChanges;           // Issued to OpenGL
+    int stateChangesElided;     // Skipped as redundant
+    int objectsVisible;         // Tested by the view volume
+    int objectsCulled;
+};
 
 class GLWindow: public GWindow {
     // Data members
@@ -24,17 +97,65 @@ public:
     static XVisualInfo* gl_visual;
     static bool         gl_swap_flag;
 
+    // Offscreen backend
+    static bool         gl_offscreen;
+    static EGLDisplay   gl_egl_display;
+    static EGLConfig    gl_egl_config;
+    static int          gl_offscreen_frames;    // Frames before closing
+    static const char*  gl_offscreen_output;    // Names of frame files
+
+    // All windows, for the context sharing and the scheduler
+    static GLWindow*    gl_first_window;
+    static GLWindow*    gl_current_window;      // Its context is current
+    static FramePacer   gl_scheduler_pacer;     // See renderDirtyWindows()
+    GLWindow*           m_NextGLWindow;
+
     GLXContext          m_GLXContext;
     bool                m_GLXContextCreated;
 
+    EGLContext          m_EGLContext;           // Offscreen backend
+    EGLSurface          m_EGLSurface;
+    int                 m_FrameCount;           // Frames swapped
+
+    FrameCapture*       m_Capture;              // Recording of frames
+
+    FramePacer          m_Pacer;
+    int                 m_SwapInterval;         // 0 if no swap control
+
+    DynamicResolution*  m_DynamicResolution;    // 0 if full resolution
+
+    GLShading*          m_Shading;              // 0 for fixed-function path
+    SphereImpostors*    m_SphereImpostors;      // Created on demand
+    GLfloat             m_MaterialColor[4];     // Current material
+    GLfloat             m_MaterialSpecular[4];
+    GLfloat             m_MaterialShininess;
+    bool                m_MaterialValid;
+
+    RenderQueue         m_RenderQueue;
+    GLfloat             m_Projection[16];       // glOrtho of m_ProjectionRect
+    R2Rectangle         m_ProjectionRect;
+    bool                m_ProjectionValid;
+    ViewVolume          m_ViewVolume;           // Of the projection
+    bool                m_ResizePending;        // Render targets not resized
+    double              m_ResizeTime;           // The last ConfigureNotify
+    RenderStats         m_FrameStats;           // The current frame
+    RenderStats         m_LastFrameStats;       // The last complete frame
+
     // Methods
 private:
     static void selectGLVisual();
+    GLWindow* shareWindow() const;
 
 public:
     GLWindow();
     virtual ~GLWindow();
 
+    // Connect to X display, or initialize the offscreen backend
+    // if there is no display. Call it instead of GWindow::initX()
+    static bool initGraphics();
+    static bool initOffscreen();
+    static bool offscreen() { return gl_offscreen; }
+
     static void initializeOpenGL();
     static void terminateOpenGL();
 
@@ -60,14 +181,137 @@ public:
     );
 
     void createGLXContext(); // Called from createWindow
+    void createOffscreenContext();
+    void destroyContext();
+    void initShading();      // Called from createWindow
+
+    bool shadersEnabled() const { return (m_Shading != 0); }
+    const GLShading* shading() const { return m_Shading; }
+
+    // Spheres drawn as impostors (see SphereImpostors.h), with the
+    // current light and material. Returns 0 for the fixed-function
+    // path: then draw the spheres by gluSphere.
+    SphereImpostors* sphereImpostors();
+
+    // Light 0. The position is transformed by the current
+    // modelview matrix, as with glLightfv(GL_LIGHT0, GL_POSITION, ...)
+    void setLight(
+        const GLfloat position[4],
+        const GLfloat ambient[4],
+        const GLfloat diffuse[4],
+        const GLfloat specular[4]
+    );
+
+    // Ambient and diffuse color of material for both sides;
+    // specular == 0 means no specular reflection.
+    // Must not be called between glBegin and glEnd.
+    void setMaterial(
+        const GLfloat color[4],
+        GLfloat shininess = 0.,
+        const GLfloat* specular = 0
+    );
+
+    // Color of the following vertices, multiplied by the material
+    // color. May be called between glBegin and glEnd.
+    void setVertexColor(const GLfloat color[4]);
+
+    // Render commands sorted by material (see RenderQueue.h)
+    RenderQueue& renderQueue() { return m_RenderQueue; }
+
+    // Statistics of the last frame shown by swapBuffers()
+    const RenderStats& renderStats() const { return m_LastFrameStats; }
+    void countStateChange(bool issued) {
+        if (issued)
+            ++m_FrameStats.stateChanges;
+        else
+            ++m_FrameStats.stateChangesElided;
+    }
+    void countCulling(bool visible) {
+        if (visible)
+            ++m_FrameStats.objectsVisible;
+        else
+            ++m_FrameStats.objectsCulled;
+    }
+
+    // Load the orthographic projection of the window coordinate
+    // rectangle into the projection matrix of the current context.
+    // The matrix is computed only when the rectangle changes.
+    void loadProjection();
+    const GLfloat* projection() const { return m_Projection; }
+
+    // View volume of the orthographic projection of the window
+    const ViewVolume& viewVolume() const { return m_ViewVolume; }
+
+    // Is an object drawn with the current modelview matrix
+    // inside the view volume?
+    bool visible(const R3Box& box);
+    bool visible(const BoundingSphere& sphere);
 
     virtual void destroyWindow();
 
+    // Nothing is done if the context of the window is already current
     void makeCurrent();
     void swapBuffers();
 
+    // Draw all windows with deferred redraw that are dirty:
+    // the context of each one is made current once, and onExpose
+    // draws and swaps it. The windows are drawn together, at most
+    // at the scheduler frame rate (fps <= 0: not paced).
+    // Returns the number of windows drawn.
+    static int renderDirtyWindows();
+    static void setSchedulerFrameRate(double fps) {
+        gl_scheduler_pacer.setFrameRate(fps);
+    }
+
+    // Write the current frame buffer to a PPM file
+    bool writePPM(const char* fileName);
+
+    // Record the frames shown by swapBuffers() into PPM files
+    // (fileName is a printf-like pattern) or a Y4M video file
+    bool startCapture(const char* fileName, int framesPerSecond = 25);
+    void stopCapture();
+    const FrameCapture* capture() const { return m_Capture; }
+
+    // Show fps frames per second; when the swap control is available,
+    // the frames are synchronized with the vertical retrace instead
+    // (at the refresh rate). fps <= 0 turns the pacing off.
+    // The context must have been created (createWindow).
+    void setFrameRate(double fps);
+    double frameRate() const { return m_Pacer.frameRate(); }
+    bool swapControl() const { return (m_SwapInterval > 0); }
+
+    // Render at a reduced resolution, so that a frame takes at most
+    // budget seconds; budget <= 0 returns to the full resolution.
+    // Returns false if framebuffer objects are not supported.
+    bool setDynamicResolution(double budget);
+    const DynamicResolution* dynamicResolution() const {
+        return m_DynamicResolution;
+    }
+
+    // Intervals between the frames shown by swapBuffers()
+    const FrameTimeStats& frameTimeStats() const { return m_Pacer.stats(); }
+    void resetFrameTimeStats() { m_Pacer.resetStats(); }
+
+private:
+    bool setSwapInterval(int interval);
+
+public:
+
     // X-Event processing
     virtual void onResize(XEvent& event);
+
+    // A resize burst ends when there was no ConfigureNotify
+    // for this time, in seconds
+    static const double RESIZE_SETTLE_TIME;
+
+private:
+    // The matrix and the volume of glOrtho for
+    // the window coordinate rectangle
+    void updateProjection();
+
+    // Called after a frame is shown: resize the render targets
+    // if the resizing has stopped, and prepare the next frame
+    void restoreRenderTarget();
 };
 
 #endif /* _GL_WINDOW_H */
@@ -12,6 +12,7 @@
 #include "gwindow.h"
 
 static void sigHandler(int sigID);      // Handler of Ctrl+C
+static long long untilNextSecond();     // Microseconds
 
 static const double PI = 3.14159265358979323846;
 static clock_t clocks_per_sec = CLOCKS_PER_SEC;
@@ -41,11 +42,6 @@ public:
     clock_t prevMoment;
     clock_t currentMoment;
 
-    // Arrows positions
-    R2Vector secondArrow;
-    R2Vector minuteArrow;
-    R2Vector hourArrow;
-
 
     ClockWindow():                     // Constructor
         hourAngle(0.),
@@ -55,16 +51,14 @@ public:
         minutes(0),
         seconds(0),
         prevMoment(0),
-        currentMoment(0),
-        secondArrow(),
-        minuteArrow(),
-        hourArrow()
+        currentMoment(0)
     {}
 
     void animate();
     void defineCurrentTime();
     void drawFace();
-    void drawArrows(bool erase = false);
+    void drawArrows();
+    R2Rectangle arrowsRectangle() const;
     void drawArrow(
         const R2Point& center,
         const R2Vector& arrow,
@@ -74,6 +68,7 @@ public:
     virtual void onKeyPress(XEvent& event);
     virtual void onButtonPress(XEvent& event);
     virtual bool onWindowClosing();
+    virtual void onTimer(int timerID);
 };
 
 double ClockWindow::cosines[360], ClockWindow::sines[360];
@@ -103,16 +98,23 @@ void ClockWindow::onExpose(XEvent& /* event */) {
     drawFace();
 
     defineCurrentTime();
-    drawArrows(false);
+    drawArrows();
 }
 
+//
+// The window is double buffered, so the square around the arrows
+// is drawn again (the face, then the arrows) off-screen and copied
+// to the window at once, without flicker of erased arrows
+//
 void ClockWindow::animate() {
     if (finished)
         return;
-    drawArrows(true);
-    defineCurrentTime();
-    drawArrows(false);
-    //... redraw();
+    redrawRectangle(arrowsRectangle());
+}
+
+// The arrows move at the beginning of every second
+void ClockWindow::onTimer(int /* timerID */) {
+    animate();
 }
 
 void ClockWindow::defineCurrentTime() {
@@ -193,7 +195,21 @@ void ClockWindow::drawFace() {
     }
 }
 
-void ClockWindow::drawArrows(bool erase /* = false */) {
+// The square that contains the arrows, with a small margin
+R2Rectangle ClockWindow::arrowsRectangle() const {
+    double maxlen = m_RWinRect.height();
+    double w = m_RWinRect.width();
+    if (w < maxlen)
+        maxlen = w;
+    double r = maxlen * 0.41;
+    return R2Rectangle(
+        (m_RWinRect.left() + m_RWinRect.right()) / 2. - r,
+        (m_RWinRect.top() + m_RWinRect.bottom()) / 2. - r,
+        2. * r, 2. * r
+    );
+}
+
+void ClockWindow::drawArrows() {
     double maxlen = m_RWinRect.height();
     double w = m_RWinRect.width();
     if (w < maxlen)
@@ -207,49 +223,30 @@ void ClockWindow::drawArrows(bool erase /* = false */) {
         (m_RWinRect.top() + m_RWinRect.bottom()) / 2.
     );
 
-    R2Vector secArrow, minArrow, hArrow;
-    if (erase) {
-        secArrow = secondArrow;
-        minArrow = minuteArrow;
-        hArrow = hourArrow;
-    } else {
-        secArrow =
-            R2Vector(cos(secondAngle), sin(secondAngle)) * secLen;
-        minArrow =
-            R2Vector(cos(minuteAngle), sin(minuteAngle)) * minLen;
-        hArrow =
-            R2Vector(cos(hourAngle), sin(hourAngle)) * hourLen;
-    }
-
-    if (erase)
-        setForeground(getBackground());
+    R2Vector secArrow =
+        R2Vector(cos(secondAngle), sin(secondAngle)) * secLen;
+    R2Vector minArrow =
+        R2Vector(cos(minuteAngle), sin(minuteAngle)) * minLen;
+    R2Vector hArrow =
+        R2Vector(cos(hourAngle), sin(hourAngle)) * hourLen;
 
     // Hour arrow
-    if (!erase)
-        setForeground("navy");
+    setForeground("navy");
     moveTo(center);
     //... drawLineTo(center + hArrow);
     drawArrow(center, hArrow, 0.1);
 
     // Minute arrow
-    if (!erase)
-        setForeground("SlateGray");
+    setForeground("SlateGray");
     moveTo(center);
     //... drawLineTo(center + minArrow);
     drawArrow(center, minArrow, 0.05);
 
     // Second arrow
-    if (!erase)
-        setForeground("red");
+    setForeground("red");
     moveTo(center);
     //... drawLineTo(center + secArrow);
     drawArrow(center, secArrow, 0.025);
-
-    if (!erase) {
-        secondArrow = secArrow;
-        minuteArrow = minArrow;
-        hourArrow = hArrow;
-    }
 }
 
 void ClockWindow::drawArrow(
@@ -353,26 +350,21 @@ int main() {
         "Graph of Function"             // Window title
     );
     w.setBackground("lightGray");
+    w.setDoubleBuffered(true);
 
     // GWindow::messageLoop();
     clocks_per_sec = (clock_t) sysconf(_SC_CLK_TCK);
 
+    // The arrows are moved by a timer, started at the next second
+    w.startTimer(1000000, untilNextSecond());
+
     // Message loop, animation
     XEvent e;
     while (!finished) {
         if (GWindow::getNextEvent(e)) {
             GWindow::dispatchEvent(e);
         } else {
-
-            // Sleep a bit (we use select for sleeping)
-            timeval dt;
-            dt.tv_sec = 0;
-            //... dt.tv_usec = 10000; // sleeping time 0.01 sec
-            dt.tv_usec = 1000000; // sleeping time 1.0 sec
-
-            select(1, 0, 0, 0, &dt);
-
-            w.animate();
+            GWindow::waitEvent();   // Sleep until an event or timer
         }
     }
 
@@ -380,6 +372,13 @@ int main() {
     return 0;
 }
 
+// Microseconds till the beginning of the next second of real time
+static long long untilNextSecond() {
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return 1000000LL - now.tv_nsec / 1000;
+}
+
 static void sigHandler(int /* sigID */) {
     finished = true;
 }
@@ -0,0 +1,166 @@
+//
+// File "colorcache.cpp"
+// Implementation of the class ColorCache
+//
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "colorcache.h"
+
+ColorCache::ColorCache():
+    m_Display(0),
+    m_Colormap(0),
+    m_BlackPixel(0),
+    m_TrueColor(false),
+    m_Table(0),
+    m_TableSize(0),
+    m_Count(0)
+{
+    for (int i = 0; i < 3; ++i) {
+        m_Shift[i] = 0;
+        m_Bits[i] = 0;
+    }
+}
+
+ColorCache::~ColorCache() {
+    clear();
+    delete[] m_Table;
+}
+
+void ColorCache::init(Display* display, int screen) {
+    clear();
+    m_Display = display;
+    m_Colormap = DefaultColormap(display, screen);
+    m_BlackPixel = BlackPixel(display, screen);
+
+    Visual* visual = DefaultVisual(display, screen);
+    m_TrueColor = (visual->c_class == TrueColor);
+    if (m_TrueColor) {
+        unsigned long masks[3] = {
+            visual->red_mask, visual->green_mask, visual->blue_mask
+        };
+        for (int i = 0; i < 3; ++i) {
+            if (masks[i] == 0) {
+                m_TrueColor = false;
+                break;
+            }
+            m_Shift[i] = __builtin_ctzl(masks[i]);
+            m_Bits[i] = __builtin_popcountl(masks[i]);
+        }
+    }
+}
+
+void ColorCache::clear() {
+    for (int i = 0; i < m_TableSize; ++i) {
+        delete[] m_Table[i].name;
+        m_Table[i].name = 0;
+    }
+    m_Count = 0;
+}
+
+unsigned long ColorCache::pixel(const char* colorName) {
+    if (m_TableSize > 0) {
+        int mask = m_TableSize - 1;
+        int i = (int) (hash(colorName) & mask);
+        while (m_Table[i].name != 0) {
+            if (equal(m_Table[i].name, colorName))
+                return m_Table[i].pixel;
+            i = (i + 1) & mask;
+        }
+    }
+    unsigned long p = allocate(colorName);
+    insert(colorName, p);
+    return p;
+}
+
+unsigned long ColorCache::pixel(int red, int green, int blue) {
+    if (m_TrueColor) {
+        // 8-bit components scaled to 16 bits
+        return trueColorPixel(red * 257, green * 257, blue * 257);
+    }
+    char name[16];
+    sprintf(name, "#%02x%02x%02x", red & 0xFF, green & 0xFF, blue & 0xFF);
+    return pixel(name);
+}
+
+unsigned long ColorCache::trueColorPixel(
+    unsigned int red, unsigned int green, unsigned int blue
+) const {
+    unsigned int c[3] = { red, green, blue };
+    unsigned long p = 0;
+    for (int i = 0; i < 3; ++i)
+        p |= (unsigned long) (c[i] >> (16 - m_Bits[i])) << m_Shift[i];
+    return p;
+}
+
+// The requests to X server: XParseColor looks up a name
+// in the color database of server, XAllocColor allocates
+// a color cell
+unsigned long ColorCache::allocate(const char* colorName) {
+    XColor c;
+    if (XParseColor(m_Display, m_Colormap, colorName, &c) == 0)
+        return m_BlackPixel;        // Unknown name
+    if (m_TrueColor)
+        return trueColorPixel(c.red, c.green, c.blue);
+    if (XAllocColor(m_Display, m_Colormap, &c) == 0)
+        return m_BlackPixel;        // The colormap is full
+    return c.pixel;
+}
+
+void ColorCache::insert(const char* name, unsigned long pixel) {
+    if (2 * (m_Count + 1) > m_TableSize)
+        grow();
+    int len = strlen(name);
+    char* lowerName = new char[len + 1];
+    for (int k = 0; k <= len; ++k)
+        lowerName[k] = (char) tolower((unsigned char) name[k]);
+
+    int mask = m_TableSize - 1;
+    int i = (int) (hash(lowerName) & mask);
+    while (m_Table[i].name != 0)
+        i = (i + 1) & mask;
+    m_Table[i].name = lowerName;
+    m_Table[i].pixel = pixel;
+    ++m_Count;
+}
+
+void ColorCache::grow() {
+    Entry* oldTable = m_Table;
+    int oldSize = m_TableSize;
+    m_TableSize = (oldSize == 0)? 64 : 2 * oldSize;
+    m_Table = new Entry[m_TableSize];
+    for (int i = 0; i < m_TableSize; ++i) {
+        m_Table[i].name = 0;
+        m_Table[i].pixel = 0;
+    }
+    int mask = m_TableSize - 1;
+    for (int i = 0; i < oldSize; ++i) {
+        if (oldTable[i].name == 0)
+            continue;
+        int j = (int) (hash(oldTable[i].name) & mask);
+        while (m_Table[j].name != 0)
+            j = (j + 1) & mask;
+        m_Table[j] = oldTable[i];
+    }
+    delete[] oldTable;
+}
+
+// FNV-1a of the name in lower case
+unsigned int ColorCache::hash(const char* name) {
+    unsigned int h = 2166136261U;
+    for (const char* p = name; *p != 0; ++p) {
+        h ^= (unsigned char) tolower((unsigned char) *p);
+        h *= 16777619U;
+    }
+    return h;
+}
+
+bool ColorCache::equal(const char* lowerName, const char* name) {
+    while (*lowerName != 0) {
+        if (*lowerName != tolower((unsigned char) *name))
+            return false;
+        ++lowerName;
+        ++name;
+    }
+    return (*name == 0);
+}
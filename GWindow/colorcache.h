@@ -0,0 +1,59 @@
+//
+// File "colorcache.h"
+//
+// Pixels of colors by name, so that a color is parsed and allocated
+// by X server (a round-trip each) only the first time it is used.
+// The names are compared in lower case, as X server does. With
+// a TrueColor visual the pixel is made of the RGB components locally,
+// without XAllocColor; other visuals allocate colors in the default
+// colormap, an RGB triple is cached by its name "#rrggbb".
+//
+#ifndef _COLORCACHE_H
+#define _COLORCACHE_H
+
+extern "C" {
+#include <X11/Xlib.h>
+}
+
+class ColorCache {
+    struct Entry {
+        char*           name;       // In lower case, 0 if unused
+        unsigned long   pixel;
+    };
+
+    Display*    m_Display;
+    Colormap    m_Colormap;
+    unsigned long m_BlackPixel;     // For unknown names
+    bool        m_TrueColor;
+    int         m_Shift[3];         // Of red, green, blue in a pixel
+    int         m_Bits[3];
+    Entry*      m_Table;            // Open addressing, linear probing
+    int         m_TableSize;        // Power of 2
+    int         m_Count;
+
+public:
+    ColorCache();
+    ~ColorCache();
+
+    void init(Display* display, int screen);
+    void clear();
+    int count() const { return m_Count; }
+
+    unsigned long pixel(const char* colorName);
+    unsigned long pixel(int red, int green, int blue);     // 0..255
+
+private:
+    ColorCache(const ColorCache&);              // Not implemented
+    ColorCache& operator=(const ColorCache&);   // Not implemented
+
+    static unsigned int hash(const char* name);
+    static bool equal(const char* lowerName, const char* name);
+    unsigned long trueColorPixel(
+        unsigned int red, unsigned int green, unsigned int blue
+    ) const;                                    // 16-bit components
+    unsigned long allocate(const char* colorName);
+    void insert(const char* name, unsigned long pixel);
+    void grow();
+};
+
+#endif /* _COLORCACHE_H */
@@ -0,0 +1,195 @@
+//
+// File "damageregion.cpp"
+// Implementation of the class DamageRegion
+//
+#include <string.h>
+#include "damageregion.h"
+
+void DamageRegion::add(int x, int y, int width, int height) {
+    if (width <= 0 || height <= 0)
+        return;
+
+    // The parts of the rectangle, that are not yet in the region
+    const int STACK_SIZE = 4 * MAX_RECTANGLES + 4;
+    Box parts[STACK_SIZE];
+    int numParts = 1;
+    parts[0].left = x; parts[0].top = y;
+    parts[0].right = x + width; parts[0].bottom = y + height;
+
+    while (numParts > 0) {
+        Box b = parts[--numParts];
+        bool done = false;
+        int i = 0;
+        while (i < m_NumRectangles) {
+            Box r = box(m_Rectangles[i]);
+            if (!overlap(b, r)) {
+                ++i;
+                continue;
+            }
+            if (contains(r, b)) {
+                done = true;            // Already damaged
+                break;
+            }
+            if (contains(b, r)) {
+                remove(i);
+                continue;
+            }
+            done = true;
+            if (numParts + 4 > STACK_SIZE) {
+                // Too many parts: take the bounding rectangle
+                absorb(b);
+                append(b);
+                break;
+            }
+
+            // Cut b by r: the bands above and below r,
+            // the parts to the left and to the right of r
+            int top = b.top, bottom = b.bottom;
+            if (b.top < r.top) {
+                parts[numParts] = b;
+                parts[numParts].bottom = r.top;
+                ++numParts;
+                top = r.top;
+            }
+            if (r.bottom < b.bottom) {
+                parts[numParts] = b;
+                parts[numParts].top = r.bottom;
+                ++numParts;
+                bottom = r.bottom;
+            }
+            if (b.left < r.left) {
+                Box& p = parts[numParts++];
+                p.left = b.left; p.right = r.left;
+                p.top = top; p.bottom = bottom;
+            }
+            if (r.right < b.right) {
+                Box& p = parts[numParts++];
+                p.left = r.right; p.right = b.right;
+                p.top = top; p.bottom = bottom;
+            }
+            break;
+        }
+        if (!done && !mergeNearby(b))
+            append(b);
+    }
+}
+
+void DamageRegion::add(const DamageRegion& region) {
+    for (int i = 0; i < region.m_NumRectangles; ++i)
+        add(region.m_Rectangles[i]);
+}
+
+XRectangle DamageRegion::bounds() const {
+    XRectangle r;
+    memset(&r, 0, sizeof(r));
+    if (m_NumRectangles == 0)
+        return r;
+    Box b = box(m_Rectangles[0]);
+    for (int i = 1; i < m_NumRectangles; ++i)
+        b = unite(b, box(m_Rectangles[i]));
+    r.x = (short) b.left;
+    r.y = (short) b.top;
+    r.width = (unsigned short) (b.right - b.left);
+    r.height = (unsigned short) (b.bottom - b.top);
+    return r;
+}
+
+bool DamageRegion::intersects(int x, int y, int width, int height) const {
+    Box b;
+    b.left = x; b.top = y;
+    b.right = x + width; b.bottom = y + height;
+    for (int i = 0; i < m_NumRectangles; ++i) {
+        if (overlap(b, box(m_Rectangles[i])))
+            return true;
+    }
+    return false;
+}
+
+DamageRegion::Box DamageRegion::box(const XRectangle& r) {
+    Box b;
+    b.left = r.x;
+    b.top = r.y;
+    b.right = r.x + r.width;
+    b.bottom = r.y + r.height;
+    return b;
+}
+
+DamageRegion::Box DamageRegion::unite(const Box& a, const Box& b) {
+    Box u;
+    u.left = (a.left < b.left)? a.left : b.left;
+    u.top = (a.top < b.top)? a.top : b.top;
+    u.right = (a.right > b.right)? a.right : b.right;
+    u.bottom = (a.bottom > b.bottom)? a.bottom : b.bottom;
+    return u;
+}
+
+void DamageRegion::set(int i, const Box& b) {
+    m_Rectangles[i].x = (short) b.left;
+    m_Rectangles[i].y = (short) b.top;
+    m_Rectangles[i].width = (unsigned short) (b.right - b.left);
+    m_Rectangles[i].height = (unsigned short) (b.bottom - b.top);
+}
+
+void DamageRegion::remove(int i) {
+    --m_NumRectangles;
+    m_Rectangles[i] = m_Rectangles[m_NumRectangles];
+}
+
+// Add a rectangle disjoint with the region
+void DamageRegion::append(Box b) {
+    if (m_NumRectangles == MAX_RECTANGLES) {
+        int best = 0;
+        long long bestWaste = waste(b, box(m_Rectangles[0]));
+        for (int i = 1; i < m_NumRectangles; ++i) {
+            long long w = waste(b, box(m_Rectangles[i]));
+            if (w < bestWaste) {
+                best = i;
+                bestWaste = w;
+            }
+        }
+        b = unite(b, box(m_Rectangles[best]));
+        remove(best);
+        absorb(b);
+    }
+    set(m_NumRectangles, b);
+    ++m_NumRectangles;
+}
+
+// Remove the rectangles overlapping b and extend b to contain them
+void DamageRegion::absorb(Box& b) {
+    int i = 0;
+    while (i < m_NumRectangles) {
+        Box r = box(m_Rectangles[i]);
+        if (overlap(b, r)) {
+            b = unite(b, r);
+            remove(i);
+            i = 0;                      // b has grown
+        } else {
+            ++i;
+        }
+    }
+}
+
+// Merge the rectangle disjoint with the region with a close one
+bool DamageRegion::mergeNearby(const Box& b) {
+    int best = (-1);
+    long long bestWaste = 0;
+    for (int i = 0; i < m_NumRectangles; ++i) {
+        Box r = box(m_Rectangles[i]);
+        long long w = waste(b, r);
+        if (
+            w * MERGE_WASTE <= b.area() + r.area() &&
+            (best < 0 || w < bestWaste)
+        ) {
+            best = i;
+            bestWaste = w;
+        }
+    }
+    if (best < 0)
+        return false;
+    Box u = unite(b, box(m_Rectangles[best]));
+    remove(best);
+    absorb(u);
+    append(u);
+    return true;
+}
@@ -0,0 +1,80 @@
+//
+// File "damageregion.h"
+//
+// A region of damaged pixels: a list of disjoint rectangles.
+// A rectangle added is cut by the rectangles already in the list
+// (its parts outside them are added); the disjoint rectangles close
+// to each other are merged into their bounding rectangle, when it
+// wastes little area (1/MERGE_WASTE of their total area). When the list
+// is full, a new rectangle is merged with the one that wastes least.
+// So two small damaged corners of a window stay two rectangles.
+//
+#ifndef _DAMAGEREGION_H
+#define _DAMAGEREGION_H
+
+extern "C" {
+#include <X11/Xlib.h>
+}
+
+class DamageRegion {
+public:
+    static const int MAX_RECTANGLES = 16;
+    static const int MERGE_WASTE = 4;   // Waste <= total area / 4
+
+private:
+    struct Box {
+        int left, top, right, bottom;   // right and bottom exclusive
+        long long area() const {
+            return (long long) (right - left) * (bottom - top);
+        }
+    };
+
+    XRectangle  m_Rectangles[MAX_RECTANGLES];
+    int         m_NumRectangles;
+
+public:
+    DamageRegion():
+        m_NumRectangles(0)
+    {}
+
+    void clear() { m_NumRectangles = 0; }
+    bool empty() const { return (m_NumRectangles == 0); }
+
+    // The rectangles, e.g. for XSetClipRectangles
+    int numRectangles() const { return m_NumRectangles; }
+    const XRectangle* rectangles() const { return m_Rectangles; }
+    const XRectangle& rectangle(int i) const { return m_Rectangles[i]; }
+
+    void add(int x, int y, int width, int height);
+    void add(const XRectangle& r) { add(r.x, r.y, r.width, r.height); }
+    void add(const DamageRegion& region);
+
+    XRectangle bounds() const;
+    bool intersects(int x, int y, int width, int height) const;
+
+private:
+    static Box box(const XRectangle& r);
+    static bool overlap(const Box& a, const Box& b) {
+        return (
+            a.left < b.right && b.left < a.right &&
+            a.top < b.bottom && b.top < a.bottom
+        );
+    }
+    static bool contains(const Box& a, const Box& b) {
+        return (
+            a.left <= b.left && b.right <= a.right &&
+            a.top <= b.top && b.bottom <= a.bottom
+        );
+    }
+    static Box unite(const Box& a, const Box& b);
+    static long long waste(const Box& a, const Box& b) {
+        return unite(a, b).area() - a.area() - b.area();
+    }
+    void set(int i, const Box& b);
+    void remove(int i);
+    void append(Box b);
+    void absorb(Box& b);
+    bool mergeNearby(const Box& b);
+};
+
+#endif /* _DAMAGEREGION_H */
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include "gwindow.h"
+#include "raster.h"
 
 //--------------------------------------------------
 // Definition of our main class "MyWindow"
@@ -15,10 +16,15 @@ class MyWindow: public GWindow {    // Our main class
     bool clicked;                   // Mouse was clicked
     unsigned int mouseButton;       // Mouse state
 public:
+    RasterImage raster;             // Software rendering of the graph
+    bool useRaster;                 // Toggled by "r"
+
     MyWindow():                     // Constructor
         lastClick(),
         clicked(false),
-        mouseButton(0)
+        mouseButton(0),
+        raster(),
+        useRaster(false)
     {}
 
     double f(double x);             // Function y = f(x)
@@ -43,16 +49,26 @@ double MyWindow::f(double x) {
 // Process the Expose event: draw in the window
 //
 void MyWindow::onExpose(XEvent& /* event */) {
-    // Erase a window
-    setForeground(getBackground());
-    fillRectangle(m_RWinRect);
-
-    // Draw the coordinate axes
-    drawAxes("black", true, "gray");
-
-    // Draw a graph of function
-    setForeground("red");
-    drawGraphic();
+    if (useRaster && raster.attach(this)) {
+        // The background and the graph are drawn by the program
+        // and sent to the window at once, the axes are drawn on top
+        raster.clear(getBackground());
+        raster.setColor(allocateColor("red"));
+        drawGraphic();
+        raster.put();
+        drawAxes("black", true, "gray");
+    } else {
+        // Erase a window
+        setForeground(getBackground());
+        fillRectangle(m_RWinRect);
+
+        // Draw the coordinate axes
+        drawAxes("black", true, "gray");
+
+        // Draw a graph of function
+        setForeground("red");
+        drawGraphic();
+    }
 
     // Draw a cross on mouse click
     if (clicked) {
@@ -83,7 +99,12 @@ void MyWindow::onKeyPress(XEvent& event) {
         keyName[nameLen] = 0;
         printf("\"%s\" button pressed.\n", keyName);
         if (keyName[0] == 'q') { // quit => close window
+            raster.destroy();
             destroyWindow();
+        } else if (keyName[0] == 'r') { // raster <=> X drawing
+            useRaster = !useRaster;
+            printf("Software rendering %s\n", useRaster? "on" : "off");
+            redraw();
         }
     }
 }
@@ -102,22 +123,27 @@ void MyWindow::onButtonPress(XEvent& event) {
 }
 
 //
-// Draw graph of function in a window
+// Draw graph of function in a window: the points are computed
+// into an array and drawn by one request
 //
 void MyWindow::drawGraphic() {
-    R2Point p;
     double dx = 0.05;
+    double xmin = getXMin();
     double xmax = getXMax();
-
-    p.x = getXMin();
-    p.y = f(p.x);
-
-    moveTo(p);
-    while (p.x < xmax) {
-        drawLineTo(p);
-        p.x += dx;
-        p.y = f(p.x);
+    int numPoints = (int) ((xmax - xmin) / dx) + 1;
+    if (numPoints < 2)
+        return;
+
+    R2Point* points = new R2Point[numPoints];
+    for (int i = 0; i < numPoints; ++i) {
+        points[i].x = xmin + i * dx;
+        points[i].y = f(points[i].x);
     }
+    if (useRaster && raster.width() > 0)
+        raster.drawLines(points, numPoints);
+    else
+        drawPolyline(points, numPoints);
+    delete[] points;
 }
 
 //
@@ -151,6 +177,7 @@ int main() {
 
     GWindow::messageLoop();
 
+    w.raster.destroy();
     GWindow::closeX();
     return 0;
 }
@@ -9,6 +9,10 @@
 #include <sys/time.h>       
 #include <sys/types.h>       
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 #include "gwindow.h"
 
@@ -16,24 +20,92 @@ Display* GWindow::m_Display = 0;
 int      GWindow::m_Screen = 0;
 Atom     GWindow::m_WMProtocolsAtom = 0;
 Atom     GWindow::m_WMDeleteWindowAtom = 0;
+bool     GWindow::m_Headless = false;
 
 int        GWindow::m_NumWindows = 0;
 int        GWindow::m_NumCreatedWindows = 0;
 ListHeader GWindow::m_WindowList(
                &GWindow::m_WindowList, &GWindow::m_WindowList
            );
+Window     GWindow::m_NextHeadlessWindow = 1;
+GWindow**  GWindow::m_WindowTable = 0;
+int        GWindow::m_WindowTableSize = 0;
+int        GWindow::m_WindowTableCount = 0;
+int        GWindow::m_WakeUpPipe[2] = { -1, -1 };
+int        GWindow::m_EventPoll = (-1);
+int        GWindow::m_EventTimer = (-1);
+TimerWheel GWindow::m_TimerWheel;
+bool       GWindow::m_ExposeQueued = false;
+ColorCache GWindow::m_ColorCache;
+XPoint*    GWindow::m_PointBuffer = 0;
+int        GWindow::m_PointBufferSize = 0;
+XSegment*  GWindow::m_SegmentBuffer = 0;
+int        GWindow::m_SegmentBufferSize = 0;
+XMotionEvent GWindow::m_MotionHistory[GWindow::MAX_MOTION_HISTORY];
+int        GWindow::m_MotionHistorySize = 0;
+
+// The colors loaded into the cache by initX()
+static const char* const preloadedColors[] = {
+    "black", "white", "red", "green", "blue", "yellow", "cyan",
+    "magenta", "gray", "lightGray", "darkGray", "navy", "brown",
+    "orange", "SlateGray", "SeaGreen"
+};
 
 bool GWindow::getNextEvent(XEvent& e) {
+    if (m_TimerWheel.numTimers() > 0)
+        dispatchTimers();
+    if (m_Display == 0)
+        return getExposeEvent(e);
+
     long eventMask =  
         ExposureMask | ButtonPressMask | ButtonReleaseMask
         | KeyPressMask | PointerMotionMask
         | StructureNotifyMask       // For resize event
         | SubstructureNotifyMask
         | FocusChangeMask;
-    return (
+    if (
         XCheckMaskEvent(m_Display, eventMask, &e) != 0 ||
         XCheckTypedEvent(m_Display, ClientMessage, &e) != 0
-    );
+    ) {
+        return true;
+    }
+
+    // Other events (e.g. NoExpose) must be removed from the queue
+    // as well, otherwise waitEvent() would not sleep
+    if (XPending(m_Display) > 0) {
+        XNextEvent(m_Display, &e);
+        return true;
+    }
+    return getExposeEvent(e);
+}
+
+// The Expose event of a window that requested a redraw. In the
+// headless mode these are the only events.
+bool GWindow::getExposeEvent(XEvent& e) {
+    if (!m_ExposeQueued)
+        return false;
+    ListHeader* p = m_WindowList.next;
+    while (p != &m_WindowList) {
+        GWindow* w = (GWindow*) p;
+        if (w->m_WindowCreated && w->m_ExposePending) {
+            // The damage is taken by dispatchEvent. The event
+            // is marked as sent, as the events of XSendEvent.
+            XRectangle bounds = w->m_Damage.bounds();
+            memset(&e, 0, sizeof(e));
+            e.type = Expose;
+            e.xany.window = w->m_Window;
+            e.xany.send_event = True;
+            e.xexpose.x = bounds.x;
+            e.xexpose.y = bounds.y;
+            e.xexpose.width = bounds.width;
+            e.xexpose.height = bounds.height;
+            e.xexpose.count = 0;
+            return true;
+        }
+        p = p->next;
+    }
+    m_ExposeQueued = false;
+    return false;
 }
 
 void GWindow::messageLoop(GWindow* dialogWnd /* = 0 */) {
@@ -48,16 +120,14 @@ void GWindow::messageLoop(GWindow* dialogWnd /* = 0 */) {
         (dialogWnd == 0 || dialogWnd->m_Window != 0)
     ) {
         //... XNextEvent(m_Display, &event);
-        if (!getNextEvent(event)) {
-            // Sleep a bit
-            timeval dt;
-            dt.tv_sec = 0;
-            dt.tv_usec = 10000;         // 0.01 sec
-            select(1, 0, 0, 0, &dt);    // sleep...
-            continue;
+        if (dispatchPendingEvents() == 0) {
+            // In the headless mode no event can come from outside,
+            // so the static picture is complete
+            if (m_Headless)
+                break;
+
+            waitEvent();    // Sleep until an event comes
         }
-        // printf("got event: type=%d\n", event.type);
-        dispatchEvent(event);
     }
 
     while (getNextEvent(event)) {
@@ -65,6 +135,209 @@ void GWindow::messageLoop(GWindow* dialogWnd /* = 0 */) {
     }
 }
 
+//
+// The redraw requests made while the batch is dispatched are coalesced
+// into one Expose event per window, that comes after the input events
+// queued before it, so a window is drawn once for the whole batch.
+//
+int GWindow::dispatchPendingEvents() {
+    XEvent event;
+    int n = 0;
+    while (
+        m_NumCreatedWindows > 0 &&
+        getNextEvent(event)
+    ) {
+        dispatchEvent(event);
+        ++n;
+    }
+    return n;
+}
+
+bool GWindow::waitEvent(long timeoutUsec /* = (-1) */) {
+    if (timeoutUsec < 0)
+        return waitEventFds(0);
+    timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeoutUsec / 1000000;
+    deadline.tv_nsec += (timeoutUsec % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000L) {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return waitEventFds(&deadline);
+}
+
+bool GWindow::waitEventUntil(const timespec& deadline) {
+    return waitEventFds(&deadline);
+}
+
+bool GWindow::waitEventFds(const timespec* deadline) {
+    // XPending also sends the output buffer to the server
+    if (m_Display != 0 && XPending(m_Display) > 0)
+        return true;
+    if (m_ExposeQueued)
+        return true;            // A window must be drawn
+
+    // The nearest deadline of timers may come first
+    long long timerDeadline;
+    timespec t;
+    if (m_TimerWheel.nextDeadline(timerDeadline)) {
+        t.tv_sec = (time_t) (timerDeadline / 1000000);
+        t.tv_nsec = (long) (timerDeadline % 1000000) * 1000;
+        if (
+            deadline == 0 || t.tv_sec < deadline->tv_sec || (
+                t.tv_sec == deadline->tv_sec &&
+                t.tv_nsec < deadline->tv_nsec
+            )
+        )
+            deadline = &t;
+    }
+
+    // In the headless mode only wakeUp() can interrupt the sleep
+    if (m_Display == 0 && m_WakeUpPipe[0] < 0 && deadline == 0)
+        return false;           // Nothing could ever come
+    bool gotEvent = false;
+    if (m_EventPoll < 0) {
+        if (deadline != 0) {
+            clock_nanosleep(
+                CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, 0
+            );
+        }
+    } else {
+        // The timer is disarmed by the zero time
+        static bool timerArmed = false;
+        if (deadline != 0 || timerArmed) {
+            itimerspec ts;
+            memset(&ts, 0, sizeof(ts));
+            if (deadline != 0) {
+                ts.it_value = *deadline;
+                if (ts.it_value.tv_sec == 0 && ts.it_value.tv_nsec == 0)
+                    ts.it_value.tv_nsec = 1;
+            }
+            timerfd_settime(m_EventTimer, TFD_TIMER_ABSTIME, &ts, 0);
+            timerArmed = (deadline != 0);
+        }
+
+        // A signal interrupts the sleep, so that the caller
+        // may check its flags
+        epoll_event events[3];
+        int n = epoll_wait(m_EventPoll, events, 3, -1);
+        if (n < 0 && errno == EINTR)
+            gotEvent = true;
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == m_EventTimer) {
+                unsigned long long expirations;
+                ssize_t res = read(fd, &expirations, sizeof(expirations));
+                (void) res;
+                timerArmed = false;
+            } else {
+                if (fd == m_WakeUpPipe[0]) {
+                    char buf[64];
+                    while (read(fd, buf, sizeof(buf)) > 0)
+                        ;       // Drain the pipe
+                }
+                gotEvent = true;
+            }
+        }
+    }
+
+    // The functions of timers may have requested redraws
+    if (m_TimerWheel.numTimers() > 0 && dispatchTimers() > 0)
+        gotEvent = true;
+    return gotEvent;
+}
+
+int GWindow::setTimer(
+    long long delayUsec, long long periodUsec,
+    TimerFunction function, void* context /* = 0 */
+) {
+    if (delayUsec < 0)
+        delayUsec = 0;
+    if (periodUsec < 0)
+        periodUsec = 0;
+    return m_TimerWheel.add(
+        TimerWheel::currentTime() + delayUsec, periodUsec,
+        function, context
+    );
+}
+
+bool GWindow::killTimer(int timerID) {
+    return m_TimerWheel.remove(timerID);
+}
+
+int GWindow::dispatchTimers() {
+    return m_TimerWheel.dispatch(TimerWheel::currentTime());
+}
+
+int GWindow::startTimer(
+    long long periodUsec, long long delayUsec /* = (-1) */
+) {
+    if (delayUsec < 0)
+        delayUsec = periodUsec;
+    return setTimer(delayUsec, periodUsec, &windowTimer, this);
+}
+
+void GWindow::windowTimer(void* window, int timerID) {
+    ((GWindow*) window)->onTimer(timerID);
+}
+
+void GWindow::wakeUp() {
+    if (m_WakeUpPipe[1] >= 0) {
+        char c = 0;
+        // If the pipe is full, waitEvent() will return anyway
+        ssize_t res = write(m_WakeUpPipe[1], &c, 1);
+        (void) res;
+    }
+}
+
+void GWindow::createWakeUpPipe() {
+    if (m_WakeUpPipe[0] >= 0)
+        return;
+    if (pipe(m_WakeUpPipe) < 0) {
+        perror("Cannot create a pipe");
+        m_WakeUpPipe[0] = (-1); m_WakeUpPipe[1] = (-1);
+        return;
+    }
+    for (int i = 0; i < 2; ++i) {
+        fcntl(m_WakeUpPipe[i], F_SETFL, O_NONBLOCK);
+        fcntl(m_WakeUpPipe[i], F_SETFD, FD_CLOEXEC);
+    }
+}
+
+//
+// The file descriptors are created once; the X connection
+// is added by initX() and removed by closeX()
+//
+void GWindow::createEventPoll() {
+    if (m_EventPoll >= 0)
+        return;
+    m_EventPoll = epoll_create1(EPOLL_CLOEXEC);
+    if (m_EventPoll < 0) {
+        perror("Cannot create an epoll instance");
+        return;
+    }
+    m_EventTimer = timerfd_create(
+        CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC
+    );
+    if (m_EventTimer < 0) {
+        perror("Cannot create a timer");
+        close(m_EventPoll);
+        m_EventPoll = (-1);
+        return;
+    }
+
+    epoll_event e;
+    memset(&e, 0, sizeof(e));
+    e.events = EPOLLIN;
+    e.data.fd = m_EventTimer;
+    epoll_ctl(m_EventPoll, EPOLL_CTL_ADD, m_EventTimer, &e);
+    if (m_WakeUpPipe[0] >= 0) {
+        e.data.fd = m_WakeUpPipe[0];
+        epoll_ctl(m_EventPoll, EPOLL_CTL_ADD, m_WakeUpPipe[0], &e);
+    }
+}
+
 void GWindow::dispatchEvent(XEvent& event) {
     // printf("got event: type=%d\n", event.type);
     GWindow* w = findWindow(event.xany.window);
@@ -80,48 +353,54 @@ void GWindow::dispatchEvent(XEvent& event) {
     if (event.type == Expose) {
         // printf("Expose event.\n");
         if (w->m_BeginExposeSeries) {
-            w->m_ClipRectangle.x = event.xexpose.x;
-            w->m_ClipRectangle.y = event.xexpose.y;
-            w->m_ClipRectangle.width = event.xexpose.width;
-            w->m_ClipRectangle.height = event.xexpose.height;
+            w->m_ExposeRegion.clear();
             w->m_BeginExposeSeries = false;
-        } else {
-            // Add the current rectangle to the clip rectangle
-            if (event.xexpose.x < w->m_ClipRectangle.x)
-                w->m_ClipRectangle.x = event.xexpose.x;
-            if (event.xexpose.y < w->m_ClipRectangle.y)
-                w->m_ClipRectangle.y = event.xexpose.y;
-            if (event.xexpose.x + event.xexpose.width >
-                w->m_ClipRectangle.x + w->m_ClipRectangle.width) {
-                w->m_ClipRectangle.width = event.xexpose.x +
-                    event.xexpose.width - w->m_ClipRectangle.x;
-            }
-            if (event.xexpose.y + event.xexpose.height >
-                w->m_ClipRectangle.y + w->m_ClipRectangle.height) {
-                w->m_ClipRectangle.height = event.xexpose.y +
-                    event.xexpose.height - w->m_ClipRectangle.y;
-            }
         }
-        if (event.xexpose.count == 0) {
-            // Restrict a drawing to clip rectangle
-            XSetClipRectangles(
-                m_Display, w->m_GC,
-                0, 0,                   // Clip origin
-                &(w->m_ClipRectangle), 1, Unsorted
+
+        // The Expose event made by getExposeEvent brings the damage
+        // of redraw() calls, an event from X server adds its rectangle
+        bool local = (event.xany.send_event && w->m_ExposePending);
+        if (!local) {
+            w->m_ExposeRegion.add(
+                event.xexpose.x, event.xexpose.y,
+                event.xexpose.width, event.xexpose.height
             );
+        }
+        if (event.xexpose.count == 0) {
+            // The damage of redraw() calls is drawn now as well
+            if (w->m_ExposePending) {
+                w->m_ExposeRegion.add(w->m_Damage);
+                w->m_Damage.clear();
+                w->m_ExposePending = false;
+            }
 
-            w->onExpose(event);
+            // The redraw() calls made from now on need a new event
+            w->m_RedrawPending = false;
+
+            // Restrict a drawing to the exposed region
+            w->setClipRegion();
+
+            if (w->prepareBackBuffer()) {
+                w->onExpose(event);
+
+                // Present the region drawn, clipped by the GC
+                XRectangle r = w->m_ExposeRegion.bounds();
+                w->m_Drawable = w->m_Window;
+                XCopyArea(
+                    m_Display, w->m_BackBuffer, w->m_Window, w->m_GC,
+                    r.x, r.y, r.width, r.height,
+                    r.x, r.y
+                );
+            } else {
+                w->onExpose(event);
+            }
 
             // Restore the clip region
-            w->m_ClipRectangle.x = 0;
-            w->m_ClipRectangle.y = 0;
-            w->m_ClipRectangle.width = w->m_IWinRect.width();
-            w->m_ClipRectangle.height = w->m_IWinRect.height();
-            XSetClipRectangles(
-                m_Display, w->m_GC,
-                0, 0,                   // Clip origin
-                &(w->m_ClipRectangle), 1, Unsorted
+            w->m_ExposeRegion.clear();
+            w->m_ExposeRegion.add(
+                0, 0, w->m_IWinRect.width(), w->m_IWinRect.height()
             );
+            w->setClipRegion();
             w->m_BeginExposeSeries = true;
         }
     } else if (event.type == KeyPress) {
@@ -135,7 +414,11 @@ void GWindow::dispatchEvent(XEvent& event) {
         w->onButtonRelease(event);
     } else if (event.type == MotionNotify) {
         // printf("MotionNotify event.\n");
+        m_MotionHistorySize = 0;
+        if (w->m_CompressMotion && m_Display != 0)
+            compressMotion(w, event);
         w->onMotionNotify(event);
+        m_MotionHistorySize = 0;
     } else if (event.type == CreateNotify) {
         // printf("CreateNotify event: m_Window=%d\n", (int) w->m_Window);
         w->onCreateNotify(event);
@@ -151,8 +434,11 @@ void GWindow::dispatchEvent(XEvent& event) {
 
         w->onDestroyNotify(event);
 
-        GWindow* destroyedWindow = findWindow(event.xdestroywindow.window);
+        GWindow* destroyedWindow = (
+            event.xdestroywindow.window == event.xany.window
+        )? w : findWindow(event.xdestroywindow.window);
         if (destroyedWindow != 0) {
+            unregisterWindow(destroyedWindow);
             if (destroyedWindow->m_WindowCreated) {
                 destroyedWindow->m_WindowCreated = false;
                 m_NumCreatedWindows--;
@@ -198,26 +484,125 @@ void GWindow::dispatchEvent(XEvent& event) {
     }
 }
 
+// Replace the event by the latest of the consecutive motion events
+// at the head of queue, that have the same window and state
+void GWindow::compressMotion(GWindow* w, XEvent& event) {
+    XEvent next;
+    while (XEventsQueued(m_Display, QueuedAlready) > 0) {
+        XPeekEvent(m_Display, &next);
+        if (
+            next.type != MotionNotify ||
+            next.xmotion.window != event.xmotion.window ||
+            next.xmotion.state != event.xmotion.state
+        )
+            break;
+        if (w->m_KeepMotionHistory) {
+            if (m_MotionHistorySize >= MAX_MOTION_HISTORY) {
+                // Keep the latest positions
+                memmove(
+                    m_MotionHistory, m_MotionHistory + 1,
+                    (MAX_MOTION_HISTORY - 1) * sizeof(XMotionEvent)
+                );
+                --m_MotionHistorySize;
+            }
+            m_MotionHistory[m_MotionHistorySize] = event.xmotion;
+            ++m_MotionHistorySize;
+        }
+        XNextEvent(m_Display, &event);
+    }
+}
+
 void GWindow::doModal() {
     messageLoop(this);
 }
 
 GWindow* GWindow::findWindow(Window w) {
-    ListHeader* p = m_WindowList.next;
-    int i = 0;
-    while (i < m_NumWindows && p != &m_WindowList) {
-        if (((GWindow*) p)->m_Window == w) {
-            return ((GWindow *)p);
-        }
-        p = p->next;
-        i++;
+    if (m_WindowTableCount == 0 || w == 0)
+        return 0;
+    int mask = m_WindowTableSize - 1;
+    for (int i = windowHash(w); m_WindowTable[i] != 0; i = (i + 1) & mask) {
+        if (m_WindowTable[i]->m_Window == w)
+            return m_WindowTable[i];
     }
     return 0;
 }
 
+// Fibonacci hashing: the ids of X windows are mostly consecutive
+int GWindow::windowHash(Window w) {
+    unsigned int h = (unsigned int) w * 2654435769U;
+    int bits = __builtin_ctz(m_WindowTableSize);    // Size is 2^bits
+    return (int) (h >> (32 - bits));
+}
+
+void GWindow::registerWindow(GWindow* w) {
+    if (w->m_Window == 0)
+        return;
+    if (2 * (m_WindowTableCount + 1) > m_WindowTableSize) {
+        // Keep the load at most 1/2: rehash into a double table
+        GWindow** oldTable = m_WindowTable;
+        int oldSize = m_WindowTableSize;
+        m_WindowTableSize = (oldSize == 0)? 64 : 2 * oldSize;
+        m_WindowTable = new GWindow*[m_WindowTableSize];
+        memset(m_WindowTable, 0, m_WindowTableSize * sizeof(GWindow*));
+        m_WindowTableCount = 0;
+        for (int i = 0; i < oldSize; ++i) {
+            if (oldTable[i] != 0)
+                registerWindow(oldTable[i]);
+        }
+        delete[] oldTable;
+    }
+    int mask = m_WindowTableSize - 1;
+    int i = windowHash(w->m_Window);
+    while (m_WindowTable[i] != 0) {
+        if (m_WindowTable[i] == w)
+            return;             // Already registered
+        i = (i + 1) & mask;
+    }
+    m_WindowTable[i] = w;
+    ++m_WindowTableCount;
+}
+
+//
+// The entries after the removed one are shifted back,
+// so that no probe sequence is broken
+//
+void GWindow::unregisterWindow(GWindow* w) {
+    if (m_WindowTableCount == 0 || w->m_Window == 0)
+        return;
+    int mask = m_WindowTableSize - 1;
+    int i = windowHash(w->m_Window);
+    while (m_WindowTable[i] != 0 && m_WindowTable[i] != w)
+        i = (i + 1) & mask;
+    if (m_WindowTable[i] == 0)
+        return;                 // Not registered
+    m_WindowTable[i] = 0;
+    --m_WindowTableCount;
+
+    int j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        if (m_WindowTable[j] == 0)
+            break;
+        int k = windowHash(m_WindowTable[j]->m_Window);
+        // Move the entry j to the hole i, unless its home
+        // position k lies cyclically in (i, j]
+        bool stays = (i <= j)? (i < k && k <= j) : (i < k || k <= j);
+        if (!stays) {
+            m_WindowTable[i] = m_WindowTable[j];
+            m_WindowTable[j] = 0;
+            i = j;
+        }
+    }
+}
+
 GWindow::GWindow():
     m_Window(0),
     m_GC(0),
+    m_Drawable(0),
+    m_BackBuffer(0),
+    m_BackBufferWidth(0),
+    m_BackBufferHeight(0),
+    m_DoubleBuffered(false),
     m_WindowPosition(0, 0),
     m_IWinRect(I2Point(0, 0), 300, 200),    // Some arbitrary values
     m_RWinRect(
@@ -234,7 +619,12 @@ GWindow::GWindow():
     m_bgColorName(0),
     m_fgColorName(0),
     m_BorderWidth(DEFAULT_BORDER_WIDTH),
-    m_BeginExposeSeries(true)
+    m_BeginExposeSeries(true),
+    m_ExposePending(false),
+    m_RedrawPending(false),
+    m_RedrawDeferred(false),
+    m_CompressMotion(true),
+    m_KeepMotionHistory(false)
 {
     strcpy(m_WindowTitle, "Graphic Window");
 }
@@ -245,6 +635,11 @@ GWindow::GWindow(
 ):
     m_Window(0),
     m_GC(0),
+    m_Drawable(0),
+    m_BackBuffer(0),
+    m_BackBufferWidth(0),
+    m_BackBufferHeight(0),
+    m_DoubleBuffered(false),
     m_WindowPosition(frameRect.left(), frameRect.top()),
     m_IWinRect(I2Point(0, 0), frameRect.width(), frameRect.height()),
     m_RWinRect(),
@@ -257,7 +652,13 @@ GWindow::GWindow(
     m_fgPixel(0),
     m_bgColorName(0),
     m_fgColorName(0),
-    m_BorderWidth(DEFAULT_BORDER_WIDTH)
+    m_BorderWidth(DEFAULT_BORDER_WIDTH),
+    m_BeginExposeSeries(true),
+    m_ExposePending(false),
+    m_RedrawPending(false),
+    m_RedrawDeferred(false),
+    m_CompressMotion(true),
+    m_KeepMotionHistory(false)
 {
     GWindow(            // Call another constructor
         frameRect,
@@ -276,6 +677,11 @@ GWindow::GWindow(
 ):
     m_Window(0),
     m_GC(0),
+    m_Drawable(0),
+    m_BackBuffer(0),
+    m_BackBufferWidth(0),
+    m_BackBufferHeight(0),
+    m_DoubleBuffered(false),
     m_WindowPosition(frameRect.left(), frameRect.top()),
     m_IWinRect(I2Point(0, 0), frameRect.width(), frameRect.height()),
     m_RWinRect(coordRect),
@@ -288,7 +694,13 @@ GWindow::GWindow(
     m_fgPixel(0),
     m_bgColorName(0),
     m_fgColorName(0),
-    m_BorderWidth(DEFAULT_BORDER_WIDTH)
+    m_BorderWidth(DEFAULT_BORDER_WIDTH),
+    m_BeginExposeSeries(true),
+    m_ExposePending(false),
+    m_RedrawPending(false),
+    m_RedrawDeferred(false),
+    m_CompressMotion(true),
+    m_KeepMotionHistory(false)
 {
     if (title == 0) {
         strcpy(m_WindowTitle, "Graphic Window");
@@ -325,6 +737,21 @@ void GWindow::createWindow(
 
     m_NumWindows++;
     m_NumCreatedWindows++;
+    m_ExposePending = false;
+    m_Damage.clear();
+
+    if (m_Headless) {
+        // No X resources: the window gets a fake id and
+        // will be exposed by the first call of getNextEvent
+        m_Window = m_NextHeadlessWindow++;
+        registerWindow(this);
+        m_WindowCreated = true;
+        m_BorderWidth = borderWidth;
+        addDamage(
+            I2Rectangle(0, 0, m_IWinRect.width(), m_IWinRect.height())
+        );
+        return;
+    }
 
     // Open a display, if necessary
     if (m_Display == 0)
@@ -347,37 +774,15 @@ void GWindow::createWindow(
         m_IWinRect = I2Rectangle(0, 0, w, h);
     }
 
-    if (m_bgColorName != 0) {
-        XColor bg;
-        XParseColor(
-            m_Display,
-            DefaultColormap(m_Display, m_Screen),
-            m_bgColorName,
-            &bg
-        );
-        XAllocColor(
-            m_Display, DefaultColormap(m_Display, m_Screen), &bg
-        );
-        m_bgPixel = bg.pixel;
-    } else {
+    if (m_bgColorName != 0)
+        m_bgPixel = allocateColor(m_bgColorName);
+    else
         m_bgPixel = WhitePixel(m_Display, m_Screen);
-    }
 
-    if (m_fgColorName != 0) {
-        XColor fg;
-        XParseColor(
-            m_Display,
-            DefaultColormap(m_Display, m_Screen),
-            m_fgColorName,
-            &fg
-        );
-        XAllocColor(
-            m_Display, DefaultColormap(m_Display, m_Screen), &fg
-        );
-        m_fgPixel = fg.pixel;
-    } else {
+    if (m_fgColorName != 0)
+        m_fgPixel = allocateColor(m_fgColorName);
+    else
         m_fgPixel = BlackPixel(m_Display, m_Screen);
-    }
 
     m_BorderWidth = borderWidth;
 
@@ -421,6 +826,8 @@ void GWindow::createWindow(
         attributesValueMask,
         winAttributes
     );
+    registerWindow(this);
+    m_Drawable = m_Window;
 
     m_WindowCreated = true;
     XSetStandardProperties(
@@ -585,6 +992,8 @@ void GWindow::createWindow(
 }
 
 GWindow::~GWindow() {
+    m_TimerWheel.removeAll(&windowTimer, this);
+    unregisterWindow(this);
     if (m_WindowCreated) {
         destroyWindow();        // Destroy window
         m_WindowCreated = false;
@@ -603,11 +1012,13 @@ void GWindow::destroyWindow() {
 
     // printf("In destroyWindow: m_Window = %d\n", (int) m_Window);
 
+    m_TimerWheel.removeAll(&windowTimer, this);
     if (!m_WindowCreated)
         return;
     m_WindowCreated = false;
     m_NumCreatedWindows--;
 
+    destroyBackBuffer();
     if (m_GC != 0) {
         XFreeGC(
             m_Display,
@@ -616,10 +1027,13 @@ void GWindow::destroyWindow() {
         m_GC = 0;
     }
     if (m_Window != 0) {
-        XDestroyWindow(
-            m_Display,
-            m_Window
-        );
+        unregisterWindow(this);
+        if (m_Display != 0) {
+            XDestroyWindow(
+                m_Display,
+                m_Window
+            );
+        }
         m_Window = 0;
     }
 }
@@ -648,6 +1062,28 @@ bool GWindow::initX() {
         "WM_DELETE_WINDOW",
         False
     );
+    createWakeUpPipe();
+    createEventPoll();
+    if (m_EventPoll >= 0) {
+        epoll_event e;
+        memset(&e, 0, sizeof(e));
+        e.events = EPOLLIN;
+        e.data.fd = ConnectionNumber(m_Display);
+        epoll_ctl(m_EventPoll, EPOLL_CTL_ADD, e.data.fd, &e);
+    }
+
+    m_ColorCache.init(m_Display, m_Screen);
+    int numColors = sizeof(preloadedColors) / sizeof(preloadedColors[0]);
+    for (int i = 0; i < numColors; ++i)
+        m_ColorCache.pixel(preloadedColors[i]);
+    return true;
+}
+
+// Work without X server (see the comment to m_Headless)
+bool GWindow::initHeadless() {
+    m_Headless = true;
+    createWakeUpPipe();
+    createEventPoll();
     return true;
 }
 
@@ -659,17 +1095,27 @@ void GWindow::closeX() {
     // printf("Closing display...\n");
     //+++
 
+    if (m_EventPoll >= 0) {
+        epoll_ctl(
+            m_EventPoll, EPOLL_CTL_DEL, ConnectionNumber(m_Display), 0
+        );
+    }
+    m_ColorCache.clear();
     XCloseDisplay(m_Display);
     m_Display = 0;
 }
 
 int GWindow::screenMaxX() {
+    if (m_Headless)
+        return HEADLESS_SCREEN_WIDTH;
     if (m_Display == 0)
         initX();
     return XDisplayWidth(m_Display, m_Screen);
 }
 
 int GWindow::screenMaxY() {
+    if (m_Headless)
+        return HEADLESS_SCREEN_HEIGHT;
     if (m_Display == 0)
         initX();
     return XDisplayHeight(m_Display, m_Screen);
@@ -835,7 +1281,7 @@ void GWindow::drawLine(const I2Point& p1, const I2Point& p2) {
     {
         ::XDrawLine(
             m_Display,
-            m_Window,
+            m_Drawable,
             m_GC,
             p1.x, p1.y,
             p2.x, p2.y
@@ -853,7 +1299,7 @@ void GWindow::drawLine(const I2Point& p1, const I2Point& p2) {
         ) {
             ::XDrawLine(
                 m_Display,
-                m_Window,
+                m_Drawable,
                 m_GC,
                 (int)(c1.x + 0.5), (int)(c1.y + 0.5),
                 (int)(c2.x + 0.5), (int)(c2.y + 0.5)
@@ -881,7 +1327,7 @@ void GWindow::drawLine(const R2Point& p1, const R2Point& p2) {
 
         ::XDrawLine(
             m_Display,
-            m_Window,
+            m_Drawable,
             m_GC,
             ip1.x, ip1.y,
             ip2.x, ip2.y
@@ -897,10 +1343,111 @@ void GWindow::drawLine(double x1, double y1, double x2, double y2) {
     drawLine(R2Point(x1, y1), R2Point(x2, y2));
 }
 
+void GWindow::drawPolyline(const R2Point* points, int numPoints) {
+    if (numPoints < 2)
+        return;
+    bool inside = true;
+    for (int i = 0; inside && i < numPoints; ++i)
+        inside = m_RWinRect.contains(points[i]);
+    if (!inside) {
+        // Clip every segment, the polyline is broken into pieces
+        XSegment* segments = segmentBuffer(numPoints - 1);
+        int n = 0;
+        R2Point c1, c2;
+        for (int i = 1; i < numPoints; ++i) {
+            if (m_RWinRect.clip(points[i - 1], points[i], c1, c2)) {
+                segments[n].x1 = (short) mapX(c1.x);
+                segments[n].y1 = (short) mapY(c1.y);
+                segments[n].x2 = (short) mapX(c2.x);
+                segments[n].y2 = (short) mapY(c2.y);
+                ++n;
+            }
+        }
+        drawSegmentBuffer(n);
+        moveTo(points[numPoints - 1]);
+        return;
+    }
+
+    XPoint* pnt = pointBuffer(numPoints);
+    for (int i = 0; i < numPoints; ++i) {
+        pnt[i].x = (short) mapX(points[i].x);
+        pnt[i].y = (short) mapY(points[i].y);
+    }
+
+    // A request is limited; the pieces share their end points
+    int maxPoints = (int) XMaxRequestSize(m_Display) - 3;
+    int first = 0;
+    while (first < numPoints - 1) {
+        int n = numPoints - first;
+        if (n > maxPoints)
+            n = maxPoints;
+        ::XDrawLines(
+            m_Display,
+            m_Drawable,
+            m_GC,
+            pnt + first,
+            n,
+            CoordModeOrigin
+        );
+        first += n - 1;
+    }
+    moveTo(points[numPoints - 1]);
+}
+
+void GWindow::drawSegments(const R2Point* ends, int numSegments) {
+    if (numSegments <= 0)
+        return;
+    XSegment* segments = segmentBuffer(numSegments);
+    int n = 0;
+    R2Point c1, c2;
+    for (int i = 0; i < numSegments; ++i) {
+        if (m_RWinRect.clip(ends[2*i], ends[2*i + 1], c1, c2)) {
+            segments[n].x1 = (short) mapX(c1.x);
+            segments[n].y1 = (short) mapY(c1.y);
+            segments[n].x2 = (short) mapX(c2.x);
+            segments[n].y2 = (short) mapY(c2.y);
+            ++n;
+        }
+    }
+    drawSegmentBuffer(n);
+    moveTo(ends[2*numSegments - 1]);
+}
+
+// XDrawSegments splits a large array into several requests itself
+void GWindow::drawSegmentBuffer(int numSegments) {
+    if (numSegments <= 0)
+        return;
+    ::XDrawSegments(
+        m_Display,
+        m_Drawable,
+        m_GC,
+        m_SegmentBuffer,
+        numSegments
+    );
+}
+
+XPoint* GWindow::pointBuffer(int size) {
+    if (size > m_PointBufferSize) {
+        delete[] m_PointBuffer;
+        m_PointBufferSize = size;
+        m_PointBuffer = new XPoint[m_PointBufferSize];
+    }
+    return m_PointBuffer;
+}
+
+XSegment* GWindow::segmentBuffer(int size) {
+    if (size > m_SegmentBufferSize) {
+        delete[] m_SegmentBuffer;
+        m_SegmentBufferSize = size;
+        m_SegmentBuffer = new XSegment[m_SegmentBufferSize];
+    }
+    return m_SegmentBuffer;
+}
+
 void GWindow::fillRectangle(const I2Rectangle& r) {
     ::XFillRectangle(
         m_Display,
-        m_Window,
+        m_Drawable,
         m_GC,
         r.left(), r.top(), r.width(), r.height()
     );
@@ -915,7 +1462,7 @@ void GWindow::fillRectangle(const R2Rectangle& r) {
 
     ::XFillRectangle(
         m_Display,
-        m_Window,
+        m_Drawable,
         m_GC,
         leftTop.x, leftTop.y,
         rightBottom.x - leftTop.x, rightBottom.y - leftTop.y
@@ -935,7 +1482,7 @@ void GWindow::fillPolygon(const I2Point* points, int numPoints) {
     }
     ::XFillPolygon(
         m_Display,
-        m_Window,
+        m_Drawable,
         m_GC,
         pnt,
         numPoints,
@@ -958,35 +1505,101 @@ void GWindow::fillPolygon(const R2Point* points, int numPoints) {
 }
 
 void GWindow::redraw() {
-    if (!m_WindowCreated)
-        return;
+    if (!m_WindowCreated || m_RedrawPending)
+        return;         // The whole window will be redrawn anyway
     //... XClearWindow(m_Display, m_Window);
-    redrawRectangle(
+    m_RedrawPending = true;
+    if (m_RedrawDeferred)
+        return;
+    addDamage(
         I2Rectangle(0, 0, m_IWinRect.width(), m_IWinRect.height())
     );
 }
 
 void GWindow::redrawRectangle(const I2Rectangle& r) {
-    XRectangle rect;
-    rect.x = (short) r.left(); rect.y = (short) r.top();
-    rect.width = (unsigned short) r.width(); 
-    rect.height = (unsigned short) r.height();
-    XSetClipRectangles(
-        m_Display, m_GC, 
-        0, 0,                   // Clip origin
-        &rect, 1, Unsorted
+    if (!m_WindowCreated || m_RedrawPending)
+        return;         // The whole window will be redrawn anyway
+    if (m_RedrawDeferred) {
+        m_RedrawPending = true;
+        return;
+    }
+    addDamage(r);
+}
+
+// The rectangles requested before the window is exposed are added
+// to the damage region
+void GWindow::addDamage(const I2Rectangle& r) {
+    if (r.width() <= 0 || r.height() <= 0)
+        return;
+    m_Damage.add(r.left(), r.top(), r.width(), r.height());
+    m_ExposePending = true;
+    m_ExposeQueued = true;
+}
+
+void GWindow::setDoubleBuffered(bool doubleBuffered) {
+    m_DoubleBuffered = doubleBuffered;
+    if (!m_DoubleBuffered)
+        destroyBackBuffer();
+}
+
+// Make the back buffer of the window size the drawable and fill
+// the exposed region with the background, as X server does
+// for the window. Returns false without double buffering.
+bool GWindow::prepareBackBuffer() {
+    if (!m_DoubleBuffered || m_Display == 0 || m_GC == 0)
+        return false;
+    int width = m_IWinRect.width();
+    int height = m_IWinRect.height();
+    if (
+        m_BackBuffer == 0 ||
+        width != m_BackBufferWidth || height != m_BackBufferHeight
+    ) {
+        destroyBackBuffer();
+
+        // The depth of window, that may have its own visual
+        XWindowAttributes attributes;
+        XGetWindowAttributes(m_Display, m_Window, &attributes);
+        m_BackBuffer = XCreatePixmap(
+            m_Display, m_Window, width, height, attributes.depth
+        );
+        m_BackBufferWidth = width;
+        m_BackBufferHeight = height;
+
+        // Copying from a pixmap never needs the exposure events
+        XSetGraphicsExposures(m_Display, m_GC, False);
+    }
+
+    XRectangle r = m_ExposeRegion.bounds();
+    XSetForeground(m_Display, m_GC, m_bgPixel);
+    XFillRectangle(
+        m_Display, m_BackBuffer, m_GC, r.x, r.y, r.width, r.height
     );
+    XSetForeground(m_Display, m_GC, m_fgPixel);
+    m_Drawable = m_BackBuffer;
+    return true;
+}
 
-    XEvent e;
-    memset(&e, 0, sizeof(e));
-    e.type = Expose;
-    e.xany.window = m_Window;
-    e.xexpose.x = r.left();
-    e.xexpose.y = r.top();
-    e.xexpose.width = r.width();
-    e.xexpose.height = r.height();
-    e.xexpose.count = 0;
-    XSendEvent(m_Display, m_Window, 0, ExposureMask, &e);
+void GWindow::destroyBackBuffer() {
+    if (m_BackBuffer == 0)
+        return;
+    XFreePixmap(m_Display, m_BackBuffer);
+    m_BackBuffer = 0;
+    m_BackBufferWidth = 0;
+    m_BackBufferHeight = 0;
+    m_Drawable = m_Window;
+    if (m_GC != 0)
+        XSetGraphicsExposures(m_Display, m_GC, True);
+}
+
+void GWindow::setClipRegion() {
+    if (m_GC == 0 || m_ExposeRegion.empty())
+        return;
+    XSetClipRectangles(
+        m_Display, m_GC,
+        0, 0,                       // Clip origin
+        const_cast<XRectangle*>(m_ExposeRegion.rectangles()),
+        m_ExposeRegion.numRectangles(), Unsorted
+    );
 }
 
 void GWindow::redrawRectangle(const R2Rectangle& r) {
@@ -1009,7 +1622,7 @@ void GWindow::drawString(
         l = strlen(str);
     ::XDrawString(
         m_Display,
-        m_Window,
+        m_Drawable,
         m_GC,
         x, y,
         str, 
@@ -1030,40 +1643,42 @@ void GWindow::drawString(double x, double y, const char* str, int len) {
 }
 
 unsigned long GWindow::allocateColor(const char* colorName) {
-    XColor c;
-    XParseColor(
-        m_Display, 
-        DefaultColormap(m_Display, m_Screen), 
-        colorName,
-        &c
-    );
-    XAllocColor(
-        m_Display, DefaultColormap(m_Display, m_Screen), &c
-    );
-    return c.pixel;
+    if (m_Display == 0)
+        return 0;
+    return m_ColorCache.pixel(colorName);
+}
+
+unsigned long GWindow::allocateColor(int red, int green, int blue) {
+    if (m_Display == 0)
+        return 0;
+    return m_ColorCache.pixel(red, green, blue);
 }
 
 void GWindow::setBackground(unsigned long bg) {
-    XSetBackground(m_Display, m_GC, bg);
+    if (m_GC != 0)
+        XSetBackground(m_Display, m_GC, bg);
     m_bgPixel = bg;
 }
 
 void GWindow::setBackground(const char* colorName) {
     // printf("Setting bg color: %s\n", colorName);
     unsigned long bgPixel = allocateColor(colorName);
-    XSetBackground(m_Display, m_GC, bgPixel);
+    if (m_GC != 0)
+        XSetBackground(m_Display, m_GC, bgPixel);
     m_bgPixel = bgPixel;
 }
 
 void GWindow::setForeground(unsigned long fg) {
-    XSetForeground(m_Display, m_GC, fg);
+    if (m_GC != 0)
+        XSetForeground(m_Display, m_GC, fg);
     m_fgPixel = fg;
 }
 
 void GWindow::setForeground(const char* colorName) {
     // printf("Setting fg color: %s\n", colorName);
     unsigned long fgPixel = allocateColor(colorName);
-    XSetForeground(m_Display, m_GC, fgPixel);
+    if (m_GC != 0)
+        XSetForeground(m_Display, m_GC, fgPixel);
     m_fgPixel = fgPixel;
 }
 
@@ -1143,6 +1758,10 @@ void GWindow::onFocusOut(XEvent&) {
 
 }
 
+void GWindow::onTimer(int) {
+
+}
+
 void GWindow::recalculateMap() {
     if (m_IWinRect.width() == 0)
         m_IWinRect.setWidth(1);
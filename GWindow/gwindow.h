@@ -15,6 +15,7 @@ extern "C" {
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xos.h>
+#include <time.h>
 
 }
 
@@ -58,8 +59,16 @@ public:
     }
 };
 
+#include "timerwheel.h"     // Uses ListHeader
+#include "damageregion.h"
+#include "colorcache.h"
+
 const int DEFAULT_BORDER_WIDTH = 2;
 
+// Size of the virtual screen in the headless mode
+const int HEADLESS_SCREEN_WIDTH = 1280;
+const int HEADLESS_SCREEN_HEIGHT = 1024;
+
 class GWindow: public ListHeader {
 public:
     // Xlib objects:
@@ -69,9 +78,23 @@ public:
     static Atom         m_WMProtocolsAtom;
     static Atom         m_WMDeleteWindowAtom;
 
+    // Headless mode: there is no X server, windows exist only
+    // in memory and receive the Expose events generated by redraw().
+    // It is used for offscreen OpenGL rendering (see GLWindow).
+    static bool         m_Headless;
+
     Window   m_Window;
     GC       m_GC;
 
+    // Double buffering: onExpose draws into the back buffer,
+    // that is copied to the window. The drawing methods draw
+    // into m_Drawable, the back buffer in onExpose or the window.
+    Drawable m_Drawable;
+    Pixmap   m_BackBuffer;
+    int      m_BackBufferWidth;
+    int      m_BackBufferHeight;
+    bool     m_DoubleBuffered;
+
     // Coordinates in window
     I2Point     m_WindowPosition;   // Window position in screen coord
     I2Rectangle m_IWinRect; // Window rectangle in (local) pixel coordinates
@@ -95,6 +118,30 @@ private:
     static int          m_NumWindows;
     static int          m_NumCreatedWindows;
     static ListHeader   m_WindowList;
+    static Window       m_NextHeadlessWindow;   // Fake id of window
+
+    // Hash table of windows by id (open addressing, linear probing),
+    // so that an event finds its window in constant time
+    static GWindow**    m_WindowTable;
+    static int          m_WindowTableSize;      // Power of 2
+    static int          m_WindowTableCount;
+    static int          m_WakeUpPipe[2];        // See wakeUp()
+    static int          m_EventPoll;            // epoll of the X connection,
+    static int          m_EventTimer;           //     wake-up pipe and timerfd
+    static TimerWheel   m_TimerWheel;           // See setTimer()
+    static bool         m_ExposeQueued;         // Some window is damaged
+    static ColorCache   m_ColorCache;           // See allocateColor()
+
+    // Buffers of drawPolyline and drawSegments, reused by all windows
+    static XPoint*      m_PointBuffer;
+    static int          m_PointBufferSize;
+    static XSegment*    m_SegmentBuffer;
+    static int          m_SegmentBufferSize;
+
+    // The motion events compressed into the one being dispatched
+    static const int    MAX_MOTION_HISTORY = 64;
+    static XMotionEvent m_MotionHistory[MAX_MOTION_HISTORY];
+    static int          m_MotionHistorySize;
 
     // Background, foreground
     unsigned long       m_bgPixel;
@@ -105,10 +152,20 @@ private:
     // Border width
     int m_BorderWidth;
 
-    // Clip rectangle
-    XRectangle          m_ClipRectangle;
+    // Region exposed by the series of Expose events, the clip region
+    DamageRegion        m_ExposeRegion;
     bool                m_BeginExposeSeries;
 
+    // Damage of redraw() and redrawRectangle(), that is exposed
+    // by the message loop itself, without a round-trip to X server
+    DamageRegion        m_Damage;
+    bool                m_ExposePending;        // Damage is not empty
+    bool                m_RedrawPending;        // redraw() is requested,
+                                                // Expose is not handled yet
+    bool                m_RedrawDeferred;       // redraw() sends no Expose
+    bool                m_CompressMotion;       // See setMotionCompression
+    bool                m_KeepMotionHistory;
+
 public:
 
     GWindow();
@@ -148,12 +205,22 @@ public:
     );
 
     static bool initX();
+    static bool initHeadless();
     static void closeX();
     static int  screenMaxX();
     static int  screenMaxY();
 
 private:
     static GWindow* findWindow(Window w);
+    static int windowHash(Window w);
+    static void registerWindow(GWindow* w);     // By its m_Window
+    static void unregisterWindow(GWindow* w);
+    static void createWakeUpPipe();
+    static void createEventPoll();
+    static bool waitEventFds(const timespec* deadline);
+    static bool getExposeEvent(XEvent& e);
+    static void windowTimer(void* window, int timerID);
+    static void compressMotion(GWindow* w, XEvent& event);
 
 public:
     void drawFrame();
@@ -203,6 +270,13 @@ public:
     void drawLine(const R2Point& p,  const R2Vector& v);
     void drawLine(double x1, double y1, double x2, double y2);
 
+    // Batches: the points are clipped and mapped in one pass, and drawn
+    // by one XDrawLines or XDrawSegments request (or a few for very
+    // large arrays). A polyline that leaves the window is drawn
+    // as segments. The current position moves to the last point.
+    void drawPolyline(const R2Point* points, int numPoints);
+    void drawSegments(const R2Point* ends, int numSegments); // Pairs
+
     void drawString(int x, int y, const char *str, int len = (-1));
     void drawString(const I2Point& p, const char *str, int len = (-1));
     void drawString(const R2Point& p, const char *str, int len = (-1));
@@ -212,7 +286,10 @@ public:
     void setBgColorName(const char* colorName);
     void setFgColorName(const char* colorName);
 
+    // The pixels are cached: only the first use of a color name
+    // makes requests to X server. initX() preloads the common colors.
     unsigned long allocateColor(const char *colorName);
+    unsigned long allocateColor(int red, int green, int blue); // 0..255
 
     void setBackground(unsigned long bg);
     void setBackground(const char *colorName);
@@ -228,9 +305,37 @@ public:
     void fillPolygon(const R2Point* points, int numPoints);
     void fillPolygon(const I2Point* points, int numPoints);
 
+    // Request the Expose event for the window. The requests made
+    // before the window is exposed are coalesced into one event,
+    // so the window is drawn once however many times the state changed.
+    // The event is not sent to X server: getNextEvent makes it
+    // when the input queued before is processed.
     void redraw();
     void redrawRectangle(const R2Rectangle&);
     void redrawRectangle(const I2Rectangle&);
+    bool redrawPending() const { return m_RedrawPending; }
+
+    // With double buffering onExpose composes the picture off-screen,
+    // in a Pixmap of the window size, which is then presented by one
+    // XCopyArea of the exposed region: no flicker, when the picture
+    // is erased and drawn again. The drawing made outside onExpose
+    // goes directly to the window. Off by default.
+    void setDoubleBuffered(bool doubleBuffered);
+    bool doubleBuffered() const { return m_DoubleBuffered; }
+
+    // The region drawn by onExpose, the drawing is clipped by it.
+    // A window may skip the objects that do not intersect it.
+    const DamageRegion& exposeRegion() const { return m_ExposeRegion; }
+    bool windowCreated() const { return m_WindowCreated; }
+
+    // In the deferred mode redraw() and redrawRectangle() only mark
+    // the window as dirty, without sending an Expose event; the
+    // application draws the dirty windows itself when it is ready
+    // (see GLWindow::renderDirtyWindows) and calls clearRedrawPending().
+    // The Expose events sent by X server are processed as usual.
+    void setRedrawDeferred(bool deferred) { m_RedrawDeferred = deferred; }
+    bool redrawDeferred() const { return m_RedrawDeferred; }
+    void clearRedrawPending() { m_RedrawPending = false; }
 
     void setWindowTitle(const char* title);
 
@@ -260,6 +365,7 @@ public:
     virtual void onDestroyNotify(XEvent& event);
     virtual void onFocusIn(XEvent& event);
     virtual void onFocusOut(XEvent& event);
+    virtual void onTimer(int timerID);     // See startTimer()
 
     // Message from Window Manager, such as "Close Window"
     virtual void onClientMessage(XEvent& event);
@@ -277,6 +383,61 @@ public:
     static void dispatchEvent(XEvent& e);
     static void messageLoop(GWindow* = 0);
 
+    // Dispatch all events that are in the queue now, so that a frame
+    // is drawn after the whole batch of input. Returns their number.
+    static int dispatchPendingEvents();
+
+    // The consecutive motion events of a window with the same state
+    // of buttons and modifiers are compressed into the latest one:
+    // a fast drag calls onMotionNotify (and redraw) once per batch,
+    // not once per pointer position. With the history enabled,
+    // the skipped events, the oldest first, are available
+    // in onMotionNotify (e.g. for free-hand drawing). Compression is
+    // on by default, history is off.
+    void setMotionCompression(bool compress) { m_CompressMotion = compress; }
+    bool motionCompression() const { return m_CompressMotion; }
+    void setMotionHistory(bool keep) { m_KeepMotionHistory = keep; }
+    static int motionHistorySize() { return m_MotionHistorySize; }
+    static const XMotionEvent& motionHistory(int i) {
+        return m_MotionHistory[i];
+    }
+
+    // Sleep until an event comes or timeout (in microseconds)
+    // expires; timeout < 0 means to wait without limit.
+    // Returns true if there may be events to process.
+    // The thread sleeps in epoll_wait on the X connection, the wake-up
+    // pipe and a timerfd, so input is handled at once, and a program
+    // without deadlines does not wake up at all while idle.
+    static bool waitEvent(long timeoutUsec = (-1));
+
+    // The same until an absolute time of CLOCK_MONOTONIC, e.g. the time
+    // of the next animation frame. Returns false when it is reached.
+    static bool waitEventUntil(const timespec& deadline);
+
+    // Timers: the function is called by the message loop (from
+    // getNextEvent and waitEvent, that sleeps until the nearest
+    // deadline) delayUsec microseconds later, and then every periodUsec
+    // microseconds if periodUsec > 0. A late periodic timer skips
+    // the missed periods. Returns the id of timer, that is reused
+    // after killTimer. Not thread-safe: use wakeUp() from other threads.
+    static int setTimer(
+        long long delayUsec, long long periodUsec,
+        TimerFunction function, void* context = 0
+    );
+    static bool killTimer(int timerID);
+    static int dispatchTimers();        // Returns the number of calls
+
+    // Timers of this window, that call onTimer(timerID). They are
+    // killed when the window is destroyed. delayUsec < 0 means
+    // the first call after periodUsec.
+    int startTimer(long long periodUsec, long long delayUsec = (-1));
+    void stopTimer(int timerID) { killTimer(timerID); }
+
+    // Interrupt waitEvent(). May be called from any thread (it does
+    // not use Xlib), e.g. when a simulation thread has new data
+    // to draw; a call made before waitEvent() is not lost.
+    static void wakeUp();
+
     // For dialog windows
     void doModal();
 
@@ -288,6 +449,13 @@ public:
 private:
     int clip(const R2Point& p1, const R2Point& p2,
                    R2Point& c1,       R2Point& c2);
+    void addDamage(const I2Rectangle& r);
+    static XPoint* pointBuffer(int size);
+    static XSegment* segmentBuffer(int size);
+    void drawSegmentBuffer(int numSegments);
+    void setClipRegion();                   // By m_ExposeRegion
+    bool prepareBackBuffer();
+    void destroyBackBuffer();
 };
 
 #endif
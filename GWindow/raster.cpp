@@ -0,0 +1,465 @@
+//
+// File "raster.cpp"
+// Implementation of the class RasterImage
+//
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "raster.h"
+
+static bool shm_attach_failed = false;
+
+static int shmErrorHandler(Display*, XErrorEvent*) {
+    shm_attach_failed = true;
+    return 0;
+}
+
+// False for NaN and infinities
+static bool isFinite(double v) {
+    return (fabs(v) < HUGE_VAL);
+}
+
+static int hostByteOrder() {
+    unsigned int one = 1;
+    return (*((unsigned char*) &one) == 1)? LSBFirst : MSBFirst;
+}
+
+RasterImage::RasterImage():
+    m_Window(0),
+    m_Image(0),
+    m_ShmInfo(),
+    m_Shared(false),
+    m_PutPending(false),
+    m_Pixels(0),
+    m_Width(0),
+    m_Height(0),
+    m_Stride(0),
+    m_Color(0),
+    m_DirtyLeft(0),
+    m_DirtyTop(0),
+    m_DirtyRight(0),
+    m_DirtyBottom(0),
+    m_Buffer(0),
+    m_BufferSize(0)
+{}
+
+RasterImage::~RasterImage() {
+    destroy();
+    delete[] m_Buffer;
+}
+
+bool RasterImage::attach(GWindow* window) {
+    int width = window->m_IWinRect.width();
+    int height = window->m_IWinRect.height();
+    if (
+        window == m_Window && m_Pixels != 0 &&
+        width == m_Width && height == m_Height
+    )
+        return true;
+    destroy();
+    m_Window = window;
+    m_Width = width;
+    m_Height = height;
+    resetDirty();
+
+    if (GWindow::m_Display == 0) {
+        // Headless mode: nothing to show the image in
+        m_Pixels = new unsigned int[width * height];
+        m_Stride = width;
+        return true;
+    }
+
+    XWindowAttributes attributes;
+    XGetWindowAttributes(
+        GWindow::m_Display, window->m_Window, &attributes
+    );
+    if (
+        !createSharedImage(attributes.visual, attributes.depth) &&
+        !createImage(attributes.visual, attributes.depth)
+    ) {
+        destroy();
+        return false;
+    }
+    if (
+        m_Image->bits_per_pixel != 32 ||
+        m_Image->byte_order != hostByteOrder()
+    ) {
+        destroy();
+        return false;
+    }
+    m_Pixels = (unsigned int*) m_Image->data;
+    m_Stride = m_Image->bytes_per_line / 4;
+    return true;
+}
+
+bool RasterImage::createSharedImage(Visual* visual, int depth) {
+    Display* display = GWindow::m_Display;
+    if (!XShmQueryExtension(display))
+        return false;
+    m_Image = XShmCreateImage(
+        display, visual, depth, ZPixmap, 0, &m_ShmInfo, m_Width, m_Height
+    );
+    if (m_Image == 0)
+        return false;
+    m_ShmInfo.shmid = shmget(
+        IPC_PRIVATE, m_Image->bytes_per_line * m_Image->height,
+        IPC_CREAT | 0600
+    );
+    if (m_ShmInfo.shmid < 0) {
+        XDestroyImage(m_Image);
+        m_Image = 0;
+        return false;
+    }
+    m_ShmInfo.shmaddr = (char*) shmat(m_ShmInfo.shmid, 0, 0);
+    if (m_ShmInfo.shmaddr == (char*) (-1)) {
+        shmctl(m_ShmInfo.shmid, IPC_RMID, 0);
+        XDestroyImage(m_Image);
+        m_Image = 0;
+        return false;
+    }
+    m_Image->data = m_ShmInfo.shmaddr;
+    m_ShmInfo.readOnly = False;
+
+    // A remote server cannot attach the segment: BadAccess
+    shm_attach_failed = false;
+    XErrorHandler oldHandler = XSetErrorHandler(&shmErrorHandler);
+    XShmAttach(display, &m_ShmInfo);
+    XSync(display, False);
+    XSetErrorHandler(oldHandler);
+
+    // The segment is removed, when the client and the server detach it
+    shmctl(m_ShmInfo.shmid, IPC_RMID, 0);
+    if (shm_attach_failed) {
+        shmdt(m_ShmInfo.shmaddr);
+        m_Image->data = 0;
+        XDestroyImage(m_Image);
+        m_Image = 0;
+        return false;
+    }
+    m_Shared = true;
+    return true;
+}
+
+bool RasterImage::createImage(Visual* visual, int depth) {
+    m_Image = XCreateImage(
+        GWindow::m_Display, visual, depth, ZPixmap, 0, 0,
+        m_Width, m_Height, 32, 0
+    );
+    if (m_Image == 0)
+        return false;
+    // Freed by XDestroyImage
+    m_Image->data = (char*) malloc(m_Image->bytes_per_line * m_Height);
+    if (m_Image->data == 0) {
+        XDestroyImage(m_Image);
+        m_Image = 0;
+        return false;
+    }
+    return true;
+}
+
+void RasterImage::destroy() {
+    sync();
+    if (m_Image != 0) {
+        if (m_Shared) {
+            // After closeX the server has detached the segment itself
+            if (GWindow::m_Display != 0)
+                XShmDetach(GWindow::m_Display, &m_ShmInfo);
+            shmdt(m_ShmInfo.shmaddr);
+            m_Image->data = 0;
+        }
+        XDestroyImage(m_Image);
+        m_Image = 0;
+    } else {
+        delete[] m_Pixels;
+    }
+    m_Pixels = 0;
+    m_Shared = false;
+    m_Window = 0;
+    m_Width = 0;
+    m_Height = 0;
+    m_Stride = 0;
+    resetDirty();
+}
+
+void RasterImage::finishPut() {
+    if (GWindow::m_Display != 0)
+        XSync(GWindow::m_Display, False);
+    m_PutPending = false;
+}
+
+void RasterImage::put() {
+    if (m_DirtyRight <= m_DirtyLeft || m_DirtyBottom <= m_DirtyTop)
+        return;
+    if (m_Image != 0) {
+        int x = m_DirtyLeft, y = m_DirtyTop;
+        int w = m_DirtyRight - x, h = m_DirtyBottom - y;
+        if (m_Shared) {
+            XShmPutImage(
+                GWindow::m_Display, m_Window->m_Drawable, m_Window->m_GC,
+                m_Image, x, y, x, y, w, h, False
+            );
+            m_PutPending = true;
+        } else {
+            XPutImage(
+                GWindow::m_Display, m_Window->m_Drawable, m_Window->m_GC,
+                m_Image, x, y, x, y, w, h
+            );
+        }
+    }
+    resetDirty();
+}
+
+void RasterImage::clear(unsigned long pixel) {
+    unsigned int color = m_Color;
+    m_Color = (unsigned int) pixel;
+    fillRectangle(0, 0, m_Width, m_Height);
+    m_Color = color;
+}
+
+void RasterImage::fillRectangle(int x, int y, int width, int height) {
+    int right = x + width, bottom = y + height;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (right > m_Width) right = m_Width;
+    if (bottom > m_Height) bottom = m_Height;
+    if (right <= x || bottom <= y)
+        return;
+    sync();
+    unsigned int* row = m_Pixels + y * m_Stride;
+    for (int j = y; j < bottom; ++j) {
+        for (int i = x; i < right; ++i)
+            row[i] = m_Color;
+        row += m_Stride;
+    }
+    markDirty(x, y, right, bottom);
+}
+
+void RasterImage::drawLine(int x1, int y1, int x2, int y2) {
+    plotLine(x1, y1, x2, y2);
+}
+
+void RasterImage::drawLine(const R2Point& p1, const R2Point& p2) {
+    double left = m_Window->m_RWinRect.left();
+    double top = m_Window->m_RWinRect.top();
+    plotLine(
+        (p1.x - left) * m_Window->m_xcoeff, (top - p1.y) * m_Window->m_ycoeff,
+        (p2.x - left) * m_Window->m_xcoeff, (top - p2.y) * m_Window->m_ycoeff
+    );
+}
+
+void RasterImage::drawLines(const R2Point* points, int numPoints) {
+    if (numPoints < 2)
+        return;
+    double left = m_Window->m_RWinRect.left();
+    double top = m_Window->m_RWinRect.top();
+    double xcoeff = m_Window->m_xcoeff, ycoeff = m_Window->m_ycoeff;
+    double x0 = (points[0].x - left) * xcoeff;
+    double y0 = (top - points[0].y) * ycoeff;
+    for (int i = 1; i < numPoints; ++i) {
+        double x1 = (points[i].x - left) * xcoeff;
+        double y1 = (top - points[i].y) * ycoeff;
+        plotLine(x0, y0, x1, y1);
+        x0 = x1; y0 = y1;
+    }
+}
+
+//
+// Liang-Barsky clipping by the centers of border pixels. A line
+// with a non-finite coordinate (e.g. a pole of the function plotted)
+// is rejected, the same as the lines outside.
+//
+bool RasterImage::clipLine(
+    double& x1, double& y1, double& x2, double& y2
+) const {
+    double t0 = 0., t1 = 1.;
+    double dx = x2 - x1, dy = y2 - y1;
+    if (
+        !isFinite(x1) || !isFinite(y1) || !isFinite(x2) || !isFinite(y2) ||
+        !isFinite(dx) || !isFinite(dy)
+    )
+        return false;
+    double p[4] = { -dx, dx, -dy, dy };
+    double q[4] = { x1, m_Width - 1 - x1, y1, m_Height - 1 - y1 };
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0.) {
+            if (q[i] < 0.)
+                return false;       // Parallel to the border, outside
+        } else {
+            double t = q[i] / p[i];
+            if (p[i] < 0.) {
+                if (t > t1)
+                    return false;
+                if (t > t0)
+                    t0 = t;
+            } else {
+                if (t < t0)
+                    return false;
+                if (t < t1)
+                    t1 = t;
+            }
+        }
+    }
+    double x = x1, y = y1;
+    x1 = x + t0 * dx; y1 = y + t0 * dy;
+    x2 = x + t1 * dx; y2 = y + t1 * dy;
+    return true;
+}
+
+//
+// Bresenham algorithm: one store and a few integer additions per pixel
+//
+void RasterImage::plotLine(double fx1, double fy1, double fx2, double fy2) {
+    if (m_Pixels == 0 || !clipLine(fx1, fy1, fx2, fy2))
+        return;
+    sync();
+    int x1 = (int) (fx1 + 0.5), y1 = (int) (fy1 + 0.5);
+    int x2 = (int) (fx2 + 0.5), y2 = (int) (fy2 + 0.5);
+    int dx = abs(x2 - x1), dy = abs(y2 - y1);
+    int stepX = (x1 < x2)? 1 : (-1);
+    int stepY = (y1 < y2)? m_Stride : (-m_Stride);
+    unsigned int* p = m_Pixels + y1 * m_Stride + x1;
+    unsigned int color = m_Color;
+    if (dx >= dy) {
+        int d = 2 * dy - dx;
+        for (int i = 0; i <= dx; ++i) {
+            *p = color;
+            if (d > 0) {
+                p += stepY;
+                d -= 2 * dx;
+            }
+            d += 2 * dy;
+            p += stepX;
+        }
+    } else {
+        int d = 2 * dx - dy;
+        for (int i = 0; i <= dy; ++i) {
+            *p = color;
+            if (d > 0) {
+                p += stepX;
+                d -= 2 * dy;
+            }
+            d += 2 * dx;
+            p += stepY;
+        }
+    }
+    markDirty(
+        (x1 < x2)? x1 : x2, (y1 < y2)? y1 : y2,
+        ((x1 > x2)? x1 : x2) + 1, ((y1 > y2)? y1 : y2) + 1
+    );
+}
+
+void RasterImage::fillPolygon(const I2Point* points, int numPoints) {
+    if (numPoints <= 2)
+        return;
+    double* b = buffer(3 * numPoints);
+    for (int i = 0; i < numPoints; ++i) {
+        b[i] = points[i].x;
+        b[numPoints + i] = points[i].y;
+    }
+    fillSpans(b, b + numPoints, numPoints);
+}
+
+void RasterImage::fillPolygon(const R2Point* points, int numPoints) {
+    if (numPoints <= 2)
+        return;
+    double left = m_Window->m_RWinRect.left();
+    double top = m_Window->m_RWinRect.top();
+    double* b = buffer(3 * numPoints);
+    for (int i = 0; i < numPoints; ++i) {
+        b[i] = (points[i].x - left) * m_Window->m_xcoeff;
+        b[numPoints + i] = (top - points[i].y) * m_Window->m_ycoeff;
+    }
+    fillSpans(b, b + numPoints, numPoints);
+}
+
+//
+// A pixel is filled if its center is inside the polygon.
+// The crossings of a row with the edges are kept after the vertices
+// in the buffer (at most n).
+//
+void RasterImage::fillSpans(const double* x, const double* y, int n) {
+    if (m_Pixels == 0)
+        return;
+    for (int i = 0; i < n; ++i) {
+        if (!isFinite(x[i]) || !isFinite(y[i]))
+            return;
+    }
+    double yMin = y[0], yMax = y[0];
+    for (int i = 1; i < n; ++i) {
+        if (y[i] < yMin) yMin = y[i];
+        if (y[i] > yMax) yMax = y[i];
+    }
+
+    // Clamped before the conversion to int, that could overflow
+    if (yMin < 0.)
+        yMin = 0.;
+    if (yMax > m_Height)
+        yMax = m_Height;
+    if (yMin >= yMax)
+        return;
+    int top = (int) ceil(yMin - 0.5);
+    int bottom = (int) ceil(yMax - 0.5);    // Exclusive
+    if (top < 0)
+        top = 0;
+    if (bottom > m_Height)
+        bottom = m_Height;
+    if (top >= bottom)
+        return;
+    sync();
+
+    double* crossings = m_Buffer + 2 * n;
+    int left = m_Width, right = 0;
+    for (int row = top; row < bottom; ++row) {
+        double yc = row + 0.5;
+        int k = 0;
+        for (int i = 0, j = n - 1; i < n; j = i++) {
+            if ((y[i] <= yc) != (y[j] <= yc)) {
+                double c = x[i] + (yc - y[i]) * (x[j] - x[i]) / (y[j] - y[i]);
+
+                // Insertion sort: there are few crossings
+                int m = k++;
+                while (m > 0 && crossings[m - 1] > c) {
+                    crossings[m] = crossings[m - 1];
+                    --m;
+                }
+                crossings[m] = c;
+            }
+        }
+        unsigned int* pixels = m_Pixels + row * m_Stride;
+        for (int i = 0; i + 1 < k; i += 2) {
+            // Huge crossings of a huge polygon are clamped first
+            double c0 = crossings[i], c1 = crossings[i + 1];
+            if (!(c0 < c1))
+                continue;                   // Empty or NaN
+            if (c0 < 0.)
+                c0 = 0.;
+            if (c1 > m_Width)
+                c1 = m_Width;
+            int xs = (int) ceil(c0 - 0.5);
+            int xe = (int) ceil(c1 - 0.5);
+            if (xs < 0)
+                xs = 0;
+            if (xe > m_Width)
+                xe = m_Width;
+            for (int p = xs; p < xe; ++p)
+                pixels[p] = m_Color;
+            if (xs < xe) {
+                if (xs < left) left = xs;
+                if (xe > right) right = xe;
+            }
+        }
+    }
+    if (left < right)
+        markDirty(left, top, right, bottom);
+}
+
+double* RasterImage::buffer(int size) {
+    if (size > m_BufferSize) {
+        delete[] m_Buffer;
+        m_BufferSize = size;
+        m_Buffer = new double[m_BufferSize];
+    }
+    return m_Buffer;
+}
@@ -0,0 +1,115 @@
+//
+// File "raster.h"
+// Software rendering of 2D graphics for GWindow
+//
+// RasterImage is an image of the window size in the client memory.
+// Lines and polygons are rasterized into it by the program itself,
+// and the changed part is sent to the window by one request:
+// XShmPutImage, when the image is in memory shared with X server
+// (MIT-SHM extension, a local server), or XPutImage otherwise.
+// So a plot of 100000 segments costs one request instead of 100000
+// XDrawLine requests. Usage, in onExpose of a window:
+//
+//     raster.attach(this);            // In the current window size
+//     raster.clear(getBackground());
+//     raster.setColor(allocateColor("red"));
+//     raster.drawLines(points, numPoints);
+//     raster.put();                   // Into the window drawable
+//
+// The image is opaque: put() replaces the pixels of the window under
+// its changed part, so the X drawing made after it is drawn on top.
+// The coordinates are the pixels of window (int) or the coordinates
+// of GWindow (R2Point). Only the 32-bit pixels are supported (all
+// TrueColor visuals of depth 24); attach() fails on other displays,
+// and the program should draw by GWindow methods instead.
+// In the headless mode the image is drawn, but not shown.
+// The image must be destroyed before its window and closeX().
+//
+#ifndef _RASTER_H
+#define _RASTER_H
+
+#include "gwindow.h"
+
+extern "C" {
+#include <X11/extensions/XShm.h>
+}
+
+class RasterImage {
+    GWindow*        m_Window;
+    XImage*         m_Image;
+    XShmSegmentInfo m_ShmInfo;
+    bool            m_Shared;       // MIT-SHM is used
+    bool            m_PutPending;   // Server may read the shared memory
+    unsigned int*   m_Pixels;
+    int             m_Width;
+    int             m_Height;
+    int             m_Stride;       // Pixels in a row
+    unsigned int    m_Color;
+
+    // Bounds of the pixels changed after put(), exclusive
+    int             m_DirtyLeft, m_DirtyTop, m_DirtyRight, m_DirtyBottom;
+
+    double*         m_Buffer;       // Vertices and crossings of polygon
+    int             m_BufferSize;
+
+public:
+    RasterImage();
+    ~RasterImage();
+
+    // Allocate the image in the window size (again, when the size
+    // has changed). Returns false if the display is not supported.
+    bool attach(GWindow* window);
+    void destroy();
+    bool shared() const { return m_Shared; }
+
+    int width() const { return m_Width; }
+    int height() const { return m_Height; }
+    unsigned int* pixels() { sync(); return m_Pixels; }
+    int stride() const { return m_Stride; }
+
+    void setColor(unsigned long pixel) { m_Color = (unsigned int) pixel; }
+    void clear(unsigned long pixel);
+
+    void fillRectangle(int x, int y, int width, int height);
+    void drawLine(int x1, int y1, int x2, int y2);
+    void drawLine(const R2Point& p1, const R2Point& p2);
+    void drawLines(const R2Point* points, int numPoints);  // Polyline
+
+    // Even-odd rule, as XFillPolygon
+    void fillPolygon(const I2Point* points, int numPoints);
+    void fillPolygon(const R2Point* points, int numPoints);
+
+    // Send the changed part of the image to the drawable of window
+    // (the back buffer in onExpose of a double buffered window)
+    void put();
+
+private:
+    RasterImage(const RasterImage&);                // Not implemented
+    RasterImage& operator=(const RasterImage&);     // Not implemented
+
+    // Wait until the server has read the shared memory
+    void sync() {
+        if (m_PutPending)
+            finishPut();
+    }
+    void finishPut();
+
+    bool createSharedImage(Visual* visual, int depth);
+    bool createImage(Visual* visual, int depth);
+    bool clipLine(double& x1, double& y1, double& x2, double& y2) const;
+    void plotLine(double x1, double y1, double x2, double y2);
+    void fillSpans(const double* x, const double* y, int n);
+    double* buffer(int size);
+    void markDirty(int left, int top, int right, int bottom) {
+        if (left < m_DirtyLeft) m_DirtyLeft = left;
+        if (top < m_DirtyTop) m_DirtyTop = top;
+        if (right > m_DirtyRight) m_DirtyRight = right;
+        if (bottom > m_DirtyBottom) m_DirtyBottom = bottom;
+    }
+    void resetDirty() {
+        m_DirtyLeft = m_Width; m_DirtyTop = m_Height;
+        m_DirtyRight = 0; m_DirtyBottom = 0;
+    }
+};
+
+#endif /* _RASTER_H */
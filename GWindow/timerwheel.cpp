@@ -0,0 +1,263 @@
+//
+// File "timerwheel.cpp"
+// Implementation of the class TimerWheel
+//
+#include <time.h>
+#include "gwindow.h"
+
+TimerWheel::TimerWheel():
+    m_Tick(currentTime() / TICK_USEC),
+    m_Timers(0),
+    m_FreeIDs(0),
+    m_NumFreeIDs(0),
+    m_TableSize(0),
+    m_NumTimers(0),
+    m_Running(0)
+{
+    for (int i = 0; i < NUM_SLOTS; ++i)
+        m_Slots[i].link(m_Slots[i]);    // Empty list
+    for (int i = 0; i < NUM_LEVELS; ++i)
+        m_LevelTimers[i] = 0;
+}
+
+TimerWheel::~TimerWheel() {
+    for (int i = 0; i < m_TableSize; ++i)
+        delete m_Timers[i];
+    delete[] m_Timers;
+    delete[] m_FreeIDs;
+}
+
+long long TimerWheel::currentTime() {
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (long long) t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+int TimerWheel::add(
+    long long deadline, long long period,
+    TimerFunction function, void* context
+) {
+    if (m_NumFreeIDs == 0) {
+        // Double the table of timers
+        int newSize = (m_TableSize == 0)? 16 : 2 * m_TableSize;
+        Timer** timers = new Timer*[newSize];
+        int* freeIDs = new int[newSize];
+        for (int i = 0; i < m_TableSize; ++i)
+            timers[i] = m_Timers[i];
+        for (int i = newSize - 1; i >= m_TableSize; --i) {
+            timers[i] = 0;
+            freeIDs[m_NumFreeIDs++] = i + 1;
+        }
+        delete[] m_Timers;
+        delete[] m_FreeIDs;
+        m_Timers = timers;
+        m_FreeIDs = freeIDs;
+        m_TableSize = newSize;
+    }
+
+    // The wheel is not advanced while there are no timers
+    if (m_NumTimers == 0 && m_Running == 0)
+        m_Tick = currentTime() / TICK_USEC;
+
+    Timer* t = new Timer();
+    t->id = m_FreeIDs[--m_NumFreeIDs];
+    t->deadline = deadline;
+    t->period = period;
+    t->function = function;
+    t->context = context;
+    t->level = (-1);
+    t->killed = false;
+    m_Timers[t->id - 1] = t;
+    ++m_NumTimers;
+    insert(t);
+    return t->id;
+}
+
+//
+// The level is chosen by the distance to the deadline, the slot
+// by the bits of its tick, so the slots of upper levels are reached
+// exactly when their ticks come. Timers beyond the range of the
+// wheel are put into its last slot and cascaded again later.
+//
+void TimerWheel::insert(Timer* t) {
+    long long tick = t->deadline / TICK_USEC;
+    if (tick < m_Tick)
+        tick = m_Tick;          // Overdue: the current slot
+    long long delta = tick - m_Tick;
+    int level = 0;
+    while (
+        level < NUM_LEVELS - 1 &&
+        delta >= (1LL << levelShift(level + 1))
+    )
+        ++level;
+    if (level == NUM_LEVELS - 1) {
+        long long range = 1LL << (levelShift(level) + LEVEL_BITS);
+        if (delta >= range)
+            tick = m_Tick + range - 1;
+    }
+    ListHeader& h = slot(level, slotIndex(level, tick));
+    h.prev->link(*t);           // Append to the list
+    t->link(h);
+    t->level = level;
+    ++m_LevelTimers[level];
+}
+
+void TimerWheel::unlink(Timer* t) {
+    t->prev->link(*(t->next));
+    if (t->level >= 0)
+        --m_LevelTimers[t->level];
+    t->level = (-1);
+}
+
+void TimerWheel::release(Timer* t) {
+    m_Timers[t->id - 1] = 0;
+    m_FreeIDs[m_NumFreeIDs++] = t->id;
+    --m_NumTimers;
+    delete t;
+}
+
+bool TimerWheel::remove(int timerID) {
+    if (!active(timerID))
+        return false;
+    Timer* t = m_Timers[timerID - 1];
+    if (t == m_Running) {
+        t->killed = true;       // Released after its function returns
+        return true;
+    }
+    unlink(t);
+    release(t);
+    return true;
+}
+
+int TimerWheel::removeAll(TimerFunction function, void* context) {
+    int n = 0;
+    for (int i = 0; i < m_TableSize; ++i) {
+        Timer* t = m_Timers[i];
+        if (
+            t != 0 && !t->killed &&
+            t->function == function && t->context == context
+        ) {
+            remove(t->id);
+            ++n;
+        }
+    }
+    return n;
+}
+
+bool TimerWheel::active(int timerID) const {
+    return (
+        timerID > 0 && timerID <= m_TableSize &&
+        m_Timers[timerID - 1] != 0 && !m_Timers[timerID - 1]->killed
+    );
+}
+
+void TimerWheel::cascade(int level) {
+    ListHeader& h = slot(level, slotIndex(level, m_Tick));
+    while (h.next != &h) {
+        Timer* t = (Timer*) h.next;
+        unlink(t);
+        insert(t);
+    }
+}
+
+int TimerWheel::dispatch(long long now) {
+    if (m_Running != 0)
+        return 0;               // Called from a function of timer
+    long long nowTick = now / TICK_USEC;
+    if (m_NumTimers == 0) {
+        if (nowTick > m_Tick)
+            m_Tick = nowTick;
+        return 0;
+    }
+    int calls = 0;
+    while (true) {
+        // Take the list of the current tick, so that the timers
+        // added by the functions are not called in this pass
+        ListHeader& h = slot(0, slotIndex(0, m_Tick));
+        ListHeader list;
+        list.link(list);
+        while (h.next != &h) {
+            Timer* t = (Timer*) h.next;
+            unlink(t);
+            list.prev->link(*t);
+            t->link(list);
+        }
+
+        while (list.next != &list) {
+            Timer* t = (Timer*) list.next;
+            t->prev->link(*(t->next));
+            if (t->deadline > now) {
+                insert(t);      // Later in the current tick
+                continue;
+            }
+            m_Running = t;
+            (*(t->function))(t->context, t->id);
+            m_Running = 0;
+            ++calls;
+            if (t->killed || t->period <= 0) {
+                release(t);
+            } else {
+                // Skip the missed periods
+                long long missed = (now - t->deadline) / t->period;
+                t->deadline += (missed + 1) * t->period;
+                insert(t);
+            }
+        }
+
+        if (m_Tick >= nowTick)
+            break;
+
+        // Nothing happens before the next cascade of the lowest
+        // non-empty level
+        int lowest = 0;
+        while (lowest < NUM_LEVELS && m_LevelTimers[lowest] == 0)
+            ++lowest;
+        if (lowest == 0) {
+            ++m_Tick;
+        } else if (lowest == NUM_LEVELS) {
+            m_Tick = nowTick;
+        } else {
+            long long step = 1LL << levelShift(lowest);
+            long long next = (m_Tick | (step - 1)) + 1;
+            m_Tick = (next < nowTick)? next : nowTick;
+        }
+        for (int level = NUM_LEVELS - 1; level > 0; --level) {
+            long long mask = (1LL << levelShift(level)) - 1;
+            if ((m_Tick & mask) == 0)
+                cascade(level);
+        }
+    }
+    return calls;
+}
+
+//
+// In each level the slots are ordered by time starting from
+// the current one, so the earliest timer is in the first non-empty
+// slot of some level. The current slot of an upper level is already
+// cascaded: its timers belong to the next round and are seen last.
+//
+bool TimerWheel::nextDeadline(long long& deadline) const {
+    if (m_NumTimers == 0)
+        return false;
+    bool found = false;
+    for (int level = 0; level < NUM_LEVELS; ++level) {
+        int n = levelSlots(level);
+        int first = slotIndex(level, m_Tick);
+        if (level > 0)
+            ++first;
+        for (int i = 0; i < n; ++i) {
+            const ListHeader& h = slot(level, (first + i) & (n - 1));
+            if (h.next == &h)
+                continue;
+            for (const ListHeader* p = h.next; p != &h; p = p->next) {
+                const Timer* t = (const Timer*) p;
+                if (!found || t->deadline < deadline) {
+                    deadline = t->deadline;
+                    found = true;
+                }
+            }
+            break;
+        }
+    }
+    return found;
+}
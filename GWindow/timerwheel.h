@@ -0,0 +1,103 @@
+//
+// File "timerwheel.h"
+//
+// Timers of the message loop, kept in a hierarchical timer wheel.
+// The time is counted in microseconds of CLOCK_MONOTONIC, the wheel
+// is indexed by ticks of TICK_USEC. Level 0 has a slot for each of
+// the next 256 ticks, each next level has 64 slots, a slot covering
+// all the slots of the previous level. When the time reaches a slot
+// of an upper level, its timers are moved (cascaded) to lower levels.
+// So adding and removing a timer take constant time, and so does
+// the dispatch for a tick, however many timers there are.
+// The deadlines are exact: a timer is not called before it.
+//
+// The file is included by "gwindow.h" after the class ListHeader.
+//
+#ifndef _TIMERWHEEL_H
+#define _TIMERWHEEL_H
+
+typedef void (*TimerFunction)(void* context, int timerID);
+
+class TimerWheel {
+public:
+    static const long long TICK_USEC = 1000;
+    static const int LEVEL0_BITS = 8;           // 256 slots
+    static const int LEVEL_BITS = 6;            // 64 slots
+    static const int NUM_LEVELS = 4;
+    static const int NUM_SLOTS =
+        (1 << LEVEL0_BITS) + (NUM_LEVELS - 1) * (1 << LEVEL_BITS);
+
+private:
+    class Timer: public ListHeader {
+    public:
+        int             id;
+        long long       deadline;       // Microseconds
+        long long       period;         // 0 for a one-shot timer
+        TimerFunction   function;
+        void*           context;
+        int             level;          // In the wheel, -1 if unlinked
+        bool            killed;         // While its function is called
+    };
+
+    ListHeader  m_Slots[NUM_SLOTS];
+    int         m_LevelTimers[NUM_LEVELS];  // Empty levels are skipped
+    long long   m_Tick;         // The earlier ticks are dispatched
+    Timer**     m_Timers;       // Timers by id - 1
+    int*        m_FreeIDs;      // Stack of unused ids
+    int         m_NumFreeIDs;
+    int         m_TableSize;
+    int         m_NumTimers;
+    Timer*      m_Running;      // Timer whose function is called
+
+public:
+    TimerWheel();
+    ~TimerWheel();
+
+    static long long currentTime();     // Microseconds
+
+    // Returns the id of timer (> 0), that is reused after remove()
+    int add(
+        long long deadline, long long period,
+        TimerFunction function, void* context
+    );
+    bool remove(int timerID);
+    int removeAll(TimerFunction function, void* context);
+    bool active(int timerID) const;
+    int numTimers() const { return m_NumTimers; }
+
+    // Call the functions of expired timers.
+    // Returns the number of calls.
+    int dispatch(long long now);
+
+    // The earliest deadline; false if there are no timers
+    bool nextDeadline(long long& deadline) const;
+
+private:
+    TimerWheel(const TimerWheel&);              // Not implemented
+    TimerWheel& operator=(const TimerWheel&);   // Not implemented
+
+    static int levelShift(int level) {
+        return (level == 0)? 0 : LEVEL0_BITS + LEVEL_BITS * (level - 1);
+    }
+    static int levelSlots(int level) {
+        return (level == 0)? (1 << LEVEL0_BITS) : (1 << LEVEL_BITS);
+    }
+    ListHeader& slot(int level, int index) {
+        return m_Slots[
+            (level == 0)? index :
+            (1 << LEVEL0_BITS) + (level - 1) * (1 << LEVEL_BITS) + index
+        ];
+    }
+    const ListHeader& slot(int level, int index) const {
+        return const_cast<TimerWheel*>(this)->slot(level, index);
+    }
+    int slotIndex(int level, long long tick) const {
+        return (int) ((tick >> levelShift(level)) & (levelSlots(level) - 1));
+    }
+    void insert(Timer* t);
+    void unlink(Timer* t);
+    void cascade(int level);
+    void release(Timer* t);
+};
+
+#endif /* _TIMERWHEEL_H */
@@ -0,0 +1,115 @@
+//
+// File "RenderQueue.cpp"
+// Implementation of the class RenderQueue
+//
+#include <string.h>
+#include <algorithm>
+#include "RenderQueue.h"
+#include "GLWindow.h"
+
+RenderQueue::RenderQueue(GLWindow* window):
+    m_Window(window),
+    m_Materials(),
+    m_Items()
+{}
+
+int RenderQueue::materialKey(
+    const GLfloat color[4],
+    GLfloat shininess /* = 0. */,
+    const GLfloat* specular /* = 0 */
+) {
+    Material m;
+    memset(&m, 0, sizeof(m));       // Padding is compared too
+    for (int i = 0; i < 4; ++i)
+        m.color[i] = color[i];
+    if (specular != 0) {
+        for (int i = 0; i < 4; ++i)
+            m.specular[i] = specular[i];
+    } else {
+        m.specular[3] = 1.;
+    }
+    m.shininess = shininess;
+
+    // A scene has a few materials, so a linear search is enough
+    int n = (int) m_Materials.size();
+    for (int i = 0; i < n; ++i) {
+        if (memcmp(&(m_Materials[i]), &m, sizeof(Material)) == 0)
+            return i;
+    }
+    m_Materials.push_back(m);
+    return n;
+}
+
+void RenderQueue::submit(
+    int material, DrawFunction draw, void* context, int param /* = 0 */
+) {
+    DrawItem item;
+    item.material = material;
+    item.sequence = (int) m_Items.size();
+    glGetFloatv(GL_MODELVIEW_MATRIX, item.matrix);
+    item.draw = draw;
+    item.context = context;
+    item.param = param;
+    m_Items.push_back(item);
+}
+
+bool RenderQueue::submit(
+    int material, DrawFunction draw, void* context, int param,
+    const BoundingSphere& bounds
+) {
+    DrawItem item;
+    glGetFloatv(GL_MODELVIEW_MATRIX, item.matrix);
+    bool visible = m_Window->viewVolume().visible(item.matrix, bounds);
+    m_Window->countCulling(visible);
+    if (!visible)
+        return false;
+    item.material = material;
+    item.sequence = (int) m_Items.size();
+    item.draw = draw;
+    item.context = context;
+    item.param = param;
+    m_Items.push_back(item);
+    return true;
+}
+
+bool RenderQueue::lessItem(const DrawItem& a, const DrawItem& b) {
+    if (a.material != b.material)
+        return (a.material < b.material);
+    return (a.sequence < b.sequence);
+}
+
+void RenderQueue::flush() {
+    std::sort(m_Items.begin(), m_Items.end(), &lessItem);
+
+    GLint matrixMode;
+    glGetIntegerv(GL_MATRIX_MODE, &matrixMode);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+
+    const GLfloat* matrix = 0;
+    int n = (int) m_Items.size();
+    for (int i = 0; i < n; ++i) {
+        const DrawItem& item = m_Items[i];
+
+        // GLWindow elides the material, if it is already current
+        const Material& m = m_Materials[item.material];
+        m_Window->setMaterial(m.color, m.shininess, m.specular);
+
+        if (
+            matrix == 0 ||
+            memcmp(matrix, item.matrix, sizeof(item.matrix)) != 0
+        ) {
+            glLoadMatrixf(item.matrix);
+            matrix = item.matrix;
+            m_Window->countStateChange(true);
+        } else {
+            m_Window->countStateChange(false);
+        }
+
+        item.draw(item.context, item.param);
+    }
+
+    glPopMatrix();
+    glMatrixMode(matrixMode);
+    m_Items.clear();
+}
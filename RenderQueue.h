@@ -0,0 +1,94 @@
+//
+// File "RenderQueue.h"
+//
+// The definition of the class RenderQueue, a thin layer of render
+// commands over GLWindow. Instead of setting the material and
+// drawing at once, a scene submits draw items: a material key,
+// the current modelview matrix and a function that draws the
+// geometry. When the queue is flushed, the items are sorted by
+// material, and the material (and matrix) is changed only between
+// the items that really differ. The order of items with the same
+// material is preserved. The items are assumed to be opaque, so the
+// depth test makes the picture independent of the drawing order.
+// A draw function must leave the modelview matrix unchanged.
+// An item with a bounding sphere is culled by the view volume
+// of the window when it is submitted.
+//
+// Usage:
+//     RenderQueue& q = window.renderQueue();
+//     int red = q.materialKey(redColor);
+//     ...
+//     q.submit(red, &drawBall, this);
+//     ...
+//     q.flush();
+//
+#ifndef _RENDER_QUEUE_H
+#define _RENDER_QUEUE_H
+
+#include <vector>
+#include <GL/gl.h>
+#include "ViewVolume.h"
+
+class GLWindow;
+
+// Draws the geometry of an item
+typedef void (*DrawFunction)(void* context, int param);
+
+class RenderQueue {
+public:
+    struct Material {
+        GLfloat color[4];       // Ambient and diffuse
+        GLfloat specular[4];
+        GLfloat shininess;
+    };
+
+private:
+    struct DrawItem {
+        int             material;
+        int             sequence;       // Order of submission
+        GLfloat         matrix[16];     // Modelview matrix
+        DrawFunction    draw;
+        void*           context;
+        int             param;
+    };
+
+    // Data members
+    GLWindow*               m_Window;
+    std::vector<Material>   m_Materials;    // Indexed by material key
+    std::vector<DrawItem>   m_Items;
+
+    // Methods
+public:
+    RenderQueue(GLWindow* window);
+
+    // Key of material, the same parameters give the same key
+    int materialKey(
+        const GLfloat color[4],
+        GLfloat shininess = 0.,
+        const GLfloat* specular = 0
+    );
+    const Material& material(int key) const { return m_Materials[key]; }
+
+    // Record an item drawn with the current modelview matrix
+    void submit(
+        int material, DrawFunction draw, void* context, int param = 0
+    );
+
+    // The same for an item inside the bounding sphere (in the current
+    // modelview coordinates); an item outside the view volume of the
+    // window is dropped. Returns false if the item is dropped.
+    bool submit(
+        int material, DrawFunction draw, void* context, int param,
+        const BoundingSphere& bounds
+    );
+
+    // Sort the items, draw them and clear the queue
+    void flush();
+    void clear() { m_Items.clear(); }
+    int size() const { return (int) m_Items.size(); }
+
+private:
+    static bool lessItem(const DrawItem& a, const DrawItem& b);
+};
+
+#endif /* _RENDER_QUEUE_H */
@@ -0,0 +1,141 @@
+//
+// File "Simulation.cpp"
+// Implementation of the class Simulation
+//
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include "Simulation.h"
+
+static void addTime(timespec& t, double seconds) {
+    long nsec = (long) (seconds * 1e9);
+    t.tv_sec += nsec / 1000000000L;
+    t.tv_nsec += nsec % 1000000000L;
+    if (t.tv_nsec >= 1000000000L) {
+        ++t.tv_sec;
+        t.tv_nsec -= 1000000000L;
+    }
+}
+
+static bool isLater(const timespec& t1, const timespec& t2) {
+    return (
+        t1.tv_sec > t2.tv_sec ||
+        (t1.tv_sec == t2.tv_sec && t1.tv_nsec > t2.tv_nsec)
+    );
+}
+
+Simulation::Simulation(double stepTime /* = 0.01 */):
+    m_StepTime(stepTime),
+    m_Thread(),
+    m_Running(false),
+    m_Terminate(false),
+    m_Paused(false),
+    m_Steps(0)
+{
+    pthread_mutex_init(&m_Mutex, 0);
+
+    // The deadlines are measured by the monotonic clock,
+    // so changing the system time does not stop the simulation
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&m_Cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+Simulation::~Simulation() {
+    stop();
+    pthread_cond_destroy(&m_Cond);
+    pthread_mutex_destroy(&m_Mutex);
+}
+
+bool Simulation::start() {
+    if (m_Running)
+        return true;
+    m_Terminate = false;
+    if (pthread_create(&m_Thread, 0, &threadProc, this) != 0) {
+        perror("Cannot create a simulation thread");
+        return false;
+    }
+    m_Running = true;
+    return true;
+}
+
+void Simulation::stop() {
+    if (!m_Running)
+        return;
+    pthread_mutex_lock(&m_Mutex);
+    m_Terminate = true;
+    pthread_cond_signal(&m_Cond);
+    pthread_mutex_unlock(&m_Mutex);
+    pthread_join(m_Thread, 0);
+    m_Running = false;
+}
+
+void Simulation::setPaused(bool paused) {
+    pthread_mutex_lock(&m_Mutex);
+    m_Paused = paused;
+    pthread_cond_signal(&m_Cond);
+    pthread_mutex_unlock(&m_Mutex);
+}
+
+bool Simulation::paused() const {
+    pthread_mutex_lock(&m_Mutex);
+    bool p = m_Paused;
+    pthread_mutex_unlock(&m_Mutex);
+    return p;
+}
+
+long Simulation::steps() const {
+    pthread_mutex_lock(&m_Mutex);
+    long n = m_Steps;
+    pthread_mutex_unlock(&m_Mutex);
+    return n;
+}
+
+void* Simulation::threadProc(void* simulation) {
+    ((Simulation*) simulation)->run();
+    return 0;
+}
+
+// The simulation thread: does the steps at their deadlines
+// until stop() is called
+void Simulation::run() {
+    timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    addTime(deadline, m_StepTime);
+
+    pthread_mutex_lock(&m_Mutex);
+    while (!m_Terminate) {
+        if (m_Paused) {
+            pthread_cond_wait(&m_Cond, &m_Mutex);
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            addTime(deadline, m_StepTime);
+            continue;
+        }
+        if (
+            pthread_cond_timedwait(&m_Cond, &m_Mutex, &deadline) !=
+            ETIMEDOUT
+        ) {
+            continue;           // Stopped, paused or a spurious wakeup
+        }
+        pthread_mutex_unlock(&m_Mutex);
+
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int n = 0;
+        do {
+            step(m_StepTime);
+            addTime(deadline, m_StepTime);
+            ++n;
+        } while (n < MAX_CATCH_UP_STEPS && !isLater(deadline, now));
+        if (!isLater(deadline, now)) {
+            deadline = now;     // Too late, skip the rest
+            addTime(deadline, m_StepTime);
+        }
+
+        pthread_mutex_lock(&m_Mutex);
+        m_Steps += n;
+    }
+    pthread_mutex_unlock(&m_Mutex);
+}
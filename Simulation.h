@@ -0,0 +1,71 @@
+//
+// File "Simulation.h"
+//
+// The definition of the class Simulation, a base class for models
+// that are advanced by fixed time steps on their own POSIX thread.
+// The thread calls step() every stepTime seconds of real time,
+// independently of how fast the windows are drawn. A derived class
+// publishes the state after each step, usually through
+// a TripleBuffer, and calls GWindow::wakeUp() so that the thread
+// drawing the scene takes the new state and redraws the window.
+// The drawing thread keeps the OpenGL context and the X connection:
+// step() must use neither of them.
+//
+// If the thread is late (e.g. the machine is busy), the missed steps
+// are done at once, at most MAX_CATCH_UP_STEPS of them; the rest of
+// the lag is skipped.
+//
+// A derived class must call stop() in its destructor, because step()
+// cannot be called after the derived part of an object is destroyed.
+//
+#ifndef _SIMULATION_H
+#define _SIMULATION_H
+
+#include <pthread.h>
+
+class Simulation {
+public:
+    enum { MAX_CATCH_UP_STEPS = 5 };
+
+    // Data members
+private:
+    double          m_StepTime;     // In seconds
+    pthread_t       m_Thread;
+    mutable pthread_mutex_t m_Mutex;
+    pthread_cond_t  m_Cond;         // Signalled by stop() and setPaused()
+    bool            m_Running;
+    bool            m_Terminate;
+    bool            m_Paused;
+    long            m_Steps;        // Steps done
+
+    // Methods
+public:
+    Simulation(double stepTime = 0.01);
+    virtual ~Simulation();
+
+    // Start and stop the simulation thread
+    bool start();
+    void stop();
+    bool running() const { return m_Running; }
+
+    // A paused simulation sleeps until it is continued;
+    // the time of a pause is not simulated
+    void setPaused(bool paused);
+    bool paused() const;
+
+    double stepTime() const { return m_StepTime; }
+    long steps() const;
+
+protected:
+    // Advance the model by dt seconds; called in the simulation thread
+    virtual void step(double dt) = 0;
+
+private:
+    Simulation(const Simulation&);              // Not implemented
+    Simulation& operator=(const Simulation&);   // Not implemented
+
+    static void* threadProc(void* simulation);
+    void run();
+};
+
+#endif /* _SIMULATION_H */
@@ -0,0 +1,116 @@
+//
+// File "SphereImpostors.cpp"
+// Implementation of the class SphereImpostors
+//
+#define GL_GLEXT_PROTOTYPES     // Shaders
+
+#include "SphereImpostors.h"
+#include "GLShading.h"
+#include <GL/glext.h>
+
+//
+// A vertex is the center of sphere in object coordinates;
+// the texture coordinates are the corner of square (-1 or 1)
+// and the radius. The square is moved to the front of the sphere,
+// so its pixels are not rejected by the depth test too early.
+//
+static const char* vertexShaderSource =
+    "flat out vec3 eyeCenter;\n"
+    "flat out float eyeRadius;\n"
+    "out vec2 corner;\n"
+    "out vec4 vertexColor;\n"
+    "void main() {\n"
+    "    vec4 c = gl_ModelViewMatrix * gl_Vertex;\n"
+    "    eyeCenter = c.xyz / c.w;\n"
+    "    eyeRadius = gl_MultiTexCoord0.z *\n"
+    "        length(gl_ModelViewMatrix[0].xyz);\n"
+    "    corner = gl_MultiTexCoord0.xy;\n"
+    "    vertexColor = gl_Color;\n"
+    "    vec3 p = eyeCenter + eyeRadius * vec3(corner, 1.);\n"
+    "    gl_Position = gl_ProjectionMatrix * vec4(p, 1.);\n"
+    "}\n";
+
+// The view ray is parallel to the z-axis (orthographic projection)
+static const char* fragmentShaderSource =
+    "flat in vec3 eyeCenter;\n"
+    "flat in float eyeRadius;\n"
+    "in vec2 corner;\n"
+    "in vec4 vertexColor;\n"
+    "out vec4 fragColor;\n"
+    "void main() {\n"
+    "    float r2 = dot(corner, corner);\n"
+    "    if (r2 > 1.)\n"
+    "        discard;\n"
+    "    vec3 n = vec3(corner, sqrt(1. - r2));\n"
+    "    vec3 p = eyeCenter + eyeRadius * n;\n"
+    "    vec4 clip = gl_ProjectionMatrix * vec4(p, 1.);\n"
+    "    gl_FragDepth = 0.5 * (\n"
+    "        gl_DepthRange.diff * clip.z / clip.w +\n"
+    "        gl_DepthRange.near + gl_DepthRange.far\n"
+    "    );\n"
+    "    fragColor = shade(n, p, vertexColor);\n"
+    "}\n";
+
+SphereImpostors::SphereImpostors():
+    m_Program(0),
+    m_SavedProgram(0),
+    m_Count(0)
+{}
+
+SphereImpostors::~SphereImpostors() {
+    destroy();
+}
+
+bool SphereImpostors::create() {
+    destroy();
+    const char* vertexSources[2] = {
+        GLShading::versionShaderSource(),
+        vertexShaderSource
+    };
+    const char* fragmentSources[3] = {
+        GLShading::versionShaderSource(),
+        GLShading::lightingShaderSource(),
+        fragmentShaderSource
+    };
+    m_Program = GLShading::linkProgram(
+        GLShading::compileShader(GL_VERTEX_SHADER, vertexSources, 2),
+        GLShading::compileShader(GL_FRAGMENT_SHADER, fragmentSources, 3)
+    );
+    return (m_Program != 0);
+}
+
+void SphereImpostors::destroy() {
+    if (m_Program == 0)
+        return;
+    glDeleteProgram(m_Program);
+    m_Program = 0;
+}
+
+void SphereImpostors::begin() {
+    glGetIntegerv(GL_CURRENT_PROGRAM, &m_SavedProgram);
+    glUseProgram(m_Program);
+    m_Count = 0;
+    glBegin(GL_QUADS);
+}
+
+void SphereImpostors::draw(const GLfloat center[3], GLfloat radius) {
+    draw(center[0], center[1], center[2], radius);
+}
+
+void SphereImpostors::draw(GLfloat x, GLfloat y, GLfloat z, GLfloat radius) {
+    // Counterclockwise, as the front faces
+    glTexCoord3f(-1., -1., radius);
+    glVertex3f(x, y, z);
+    glTexCoord3f(1., -1., radius);
+    glVertex3f(x, y, z);
+    glTexCoord3f(1., 1., radius);
+    glVertex3f(x, y, z);
+    glTexCoord3f(-1., 1., radius);
+    glVertex3f(x, y, z);
+    ++m_Count;
+}
+
+void SphereImpostors::end() {
+    glEnd();
+    glUseProgram(m_SavedProgram);
+}
@@ -0,0 +1,62 @@
+//
+// File "SphereImpostors.h"
+//
+// The definition of the class SphereImpostors, that draws spheres
+// as impostors: each sphere is a square, aligned with the screen,
+// 2 triangles instead of the hundreds of gluSphere. The fragment
+// shader intersects the view ray with the sphere, computes its
+// normal and depth (so spheres intersect each other and the scene
+// correctly) and lights the point by the same equations as
+// GLShading, with the same light and material uniform blocks.
+// So an impostor looks like a gluSphere with per-pixel lighting,
+// without its polygonal silhouette.
+//
+// The projection must be orthographic (glOrtho), as in all windows
+// of GLWindow; the modelview matrix may rotate, translate and scale
+// uniformly. Usage, with the material set by GLWindow::setMaterial:
+//
+//     SphereImpostors* spheres = sphereImpostors();  // In GLWindow
+//     spheres->begin();
+//     for (...) {
+//         setVertexColor(color[i]);   // Optional
+//         spheres->draw(center[i], radius);
+//     }
+//     spheres->end();
+//
+// begin() and end() enclose glBegin/glEnd, so no OpenGL state
+// may be changed between them, except for the current color.
+// Requires the shader path of GLWindow (OpenGL 3.1).
+//
+#ifndef _SPHERE_IMPOSTORS_H
+#define _SPHERE_IMPOSTORS_H
+
+#include <GL/gl.h>
+
+class SphereImpostors {
+    GLuint  m_Program;
+    GLint   m_SavedProgram;     // Program current before begin()
+    int     m_Count;            // Spheres since begin()
+
+public:
+    SphereImpostors();
+    ~SphereImpostors();         // The context must be current
+
+    // Compile the program in the current context.
+    // Returns false if compilation fails.
+    bool create();
+    void destroy();
+    bool created() const { return (m_Program != 0); }
+
+    void begin();
+    void draw(const GLfloat center[3], GLfloat radius);
+    void draw(GLfloat x, GLfloat y, GLfloat z, GLfloat radius);
+    void end();
+
+    int count() const { return m_Count; }
+
+private:
+    SphereImpostors(const SphereImpostors&);            // Not implemented
+    SphereImpostors& operator=(const SphereImpostors&); // Not implemented
+};
+
+#endif /* _SPHERE_IMPOSTORS_H */
@@ -0,0 +1,220 @@
+//
+// File "SurfaceGrid.cpp"
+// Implementation of the class SurfaceGrid
+//
+// This file is compiled with the vectorisation options (see Makefile),
+// so the loops marked with "omp simd" call the SIMD versions
+// of sqrt and cos from the vector math library.
+//
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "SurfaceGrid.h"
+
+static const int BAND_ROWS = 16;    // Rows of grid processed by one task
+
+void SurfaceFunction::valueRow(
+    const double* x, double y, double* z, int n
+) const {
+    for (int i = 0; i < n; ++i)
+        z[i] = value(x[i], y);
+}
+
+void SurfaceFunction::gradientRow(
+    const double* x, double y,
+    double* z, double* zx, double* zy, int n
+) const {
+    double h = 0.0001;
+    for (int i = 0; i < n; ++i) {
+        z[i] = value(x[i], y);
+        zx[i] = (value(x[i]+h, y) - value(x[i]-h, y)) / (2.*h);
+        zy[i] = (value(x[i], y+h) - value(x[i], y-h)) / (2.*h);
+    }
+}
+
+double RadialCosine::value(double x, double y) const {
+    return radialCosine(x, y);
+}
+
+void RadialCosine::valueRow(
+    const double* x, double y, double* z, int n
+) const {
+    #pragma omp simd
+    for (int i = 0; i < n; ++i) {
+        z[i] = radialCosine(x[i], y);
+    }
+}
+
+void RadialCosine::gradientRow(
+    const double* x, double y,
+    double* z, double* zx, double* zy, int n
+) const {
+    Dual2 yy = Dual2::variableY(y);
+    #pragma omp simd
+    for (int i = 0; i < n; ++i) {
+        Dual2 r = radialCosine(Dual2::variableX(x[i]), yy);
+        z[i] = r.v; zx[i] = r.dx; zy[i] = r.dy;
+    }
+}
+
+SurfaceGrid::SurfaceGrid():
+    m_XMin(0.),
+    m_YMin(0.),
+    m_DX(1.),
+    m_DY(1.),
+    m_NX(0),
+    m_NY(0),
+    m_Vertices(0),
+    m_Normals(0),
+    m_ExactNormals(true),
+    m_X(0),
+    m_Function(0)
+{}
+
+SurfaceGrid::~SurfaceGrid() {
+    clear();
+}
+
+void SurfaceGrid::clear() {
+    delete[] m_Vertices; m_Vertices = 0;
+    delete[] m_Normals; m_Normals = 0;
+    delete[] m_X; m_X = 0;
+    m_NX = 0; m_NY = 0;
+}
+
+void SurfaceGrid::setDomain(
+    double xmin, double xmax,
+    double ymin, double ymax,
+    double dx, double dy
+) {
+    int nx = (int)((xmax - xmin) / dx + 0.5) + 1;
+    int ny = (int)((ymax - ymin) / dy + 0.5) + 1;
+    if (nx < 2)
+        nx = 2;
+    if (ny < 2)
+        ny = 2;
+
+    if (nx != m_NX || ny != m_NY) {
+        clear();
+        m_NX = nx; m_NY = ny;
+        m_Vertices = new float[3*nx*ny];
+        m_Normals = new float[3*nx*ny];
+        m_X = new double[nx + 2];
+    }
+    m_XMin = xmin; m_YMin = ymin;
+    m_DX = dx; m_DY = dy;
+
+    for (int i = 0; i < nx + 2; ++i)
+        m_X[i] = xmin + (i - 1)*dx;
+}
+
+void SurfaceGrid::evaluate(
+    const SurfaceFunction& f, ThreadPool* pool /* = 0 */
+) {
+    if (m_NX == 0)
+        return;
+    if (pool == 0)
+        pool = &ThreadPool::defaultPool();
+
+    m_Function = &f;
+    int numBands = (m_NY + BAND_ROWS - 1) / BAND_ROWS;
+    pool->run(&bandTask, this, numBands);
+    m_Function = 0;
+}
+
+void SurfaceGrid::bandTask(int band, void* grid) {
+    SurfaceGrid* g = (SurfaceGrid*) grid;
+    if (g->m_ExactNormals && g->m_Function->hasGradient())
+        g->evaluateBandWithGradient(band);
+    else
+        g->evaluateBand(band);
+}
+
+//
+// Compute the rows [j0, j1) of the grid. We keep a ring of three
+// rows of heights (j-1, j, j+1), each padded by one column on
+// both sides, so the normal at a vertex is obtained by central
+// differences of the neighbouring grid values, without extra
+// evaluations of the function.
+//
+void SurfaceGrid::evaluateBand(int band) {
+    int j0 = band * BAND_ROWS;
+    int j1 = j0 + BAND_ROWS;
+    if (j1 > m_NY)
+        j1 = m_NY;
+
+    int rowLen = m_NX + 2;
+    double* rows = new double[3*rowLen];
+    double* zPrev = rows;
+    double* zCur  = rows + rowLen;
+    double* zNext = rows + 2*rowLen;
+
+    m_Function->valueRow(m_X, m_YMin + (j0 - 1)*m_DY, zPrev, rowLen);
+    m_Function->valueRow(m_X, m_YMin + j0*m_DY, zCur, rowLen);
+
+    double cx = 1. / (2.*m_DX);
+    double cy = 1. / (2.*m_DY);
+    for (int j = j0; j < j1; ++j) {
+        double y = m_YMin + j*m_DY;
+        m_Function->valueRow(m_X, y + m_DY, zNext, rowLen);
+
+        float* v = m_Vertices + 3*j*m_NX;
+        float* n = m_Normals + 3*j*m_NX;
+        for (int i = 0; i < m_NX; ++i) {
+            // F(x, y, z) = z - f(x, y), normal = grad F
+            double dFx = -(zCur[i+2] - zCur[i]) * cx;
+            double dFy = -(zNext[i+1] - zPrev[i+1]) * cy;
+            double len = sqrt(dFx*dFx + dFy*dFy + 1.);
+
+            v[0] = (float) m_X[i+1];
+            v[1] = (float) y;
+            v[2] = (float) zCur[i+1];
+            n[0] = (float) (dFx / len);
+            n[1] = (float) (dFy / len);
+            n[2] = (float) (1. / len);
+            v += 3; n += 3;
+        }
+
+        // Rotate the ring of rows
+        double* t = zPrev;
+        zPrev = zCur; zCur = zNext; zNext = t;
+    }
+    delete[] rows;
+}
+
+//
+// Compute the rows [j0, j1) of the grid using the gradient
+// supplied by the function: one evaluation per vertex.
+//
+void SurfaceGrid::evaluateBandWithGradient(int band) {
+    int j0 = band * BAND_ROWS;
+    int j1 = j0 + BAND_ROWS;
+    if (j1 > m_NY)
+        j1 = m_NY;
+
+    double* buffer = new double[3*m_NX];
+    double* z  = buffer;
+    double* zx = buffer + m_NX;
+    double* zy = buffer + 2*m_NX;
+    const double* x = m_X + 1;      // Skip the padding column
+
+    for (int j = j0; j < j1; ++j) {
+        double y = m_YMin + j*m_DY;
+        m_Function->gradientRow(x, y, z, zx, zy, m_NX);
+
+        float* v = m_Vertices + 3*j*m_NX;
+        float* n = m_Normals + 3*j*m_NX;
+        for (int i = 0; i < m_NX; ++i) {
+            // F(x, y, z) = z - f(x, y), normal = grad F
+            double len = sqrt(zx[i]*zx[i] + zy[i]*zy[i] + 1.);
+            v[0] = (float) x[i];
+            v[1] = (float) y;
+            v[2] = (float) z[i];
+            n[0] = (float) (-zx[i] / len);
+            n[1] = (float) (-zy[i] / len);
+            n[2] = (float) (1. / len);
+            v += 3; n += 3;
+        }
+    }
+    delete[] buffer;
+}
@@ -0,0 +1,130 @@
+//
+// File "SurfaceGrid.h"
+//
+// The definition of the class SurfaceGrid,
+// that evaluates a surface z = f(x, y) on a regular grid:
+// it fills the arrays of vertices and unit normals ready
+// to be passed to OpenGL. The rows of the grid are computed
+// in parallel by a ThreadPool, the inner loop over a row is
+// written so that the compiler can vectorise it.
+//
+// The normals are computed from the exact gradient, if the function
+// provides it (see Dual.h), or else by central differences of the
+// neighbouring grid heights.
+//
+#ifndef _SURFACE_GRID_H
+#define _SURFACE_GRID_H
+
+#include "ThreadPool.h"
+#include "Dual.h"
+
+//
+// A function z = f(x, y)
+//
+class SurfaceFunction {
+public:
+    virtual ~SurfaceFunction() {}
+
+    virtual double value(double x, double y) const = 0;
+
+    // Compute z[i] = f(x[i], y) for i = 0, ..., n-1.
+    // The default implementation calls value() for every point;
+    // a derived class should override it with a loop that the
+    // compiler can vectorise.
+    virtual void valueRow(
+        const double* x, double y, double* z, int n
+    ) const;
+
+    // A function that can compute its gradient (for instance,
+    // with the dual numbers) returns true and overrides gradientRow()
+    virtual bool hasGradient() const { return false; }
+
+    // Compute z[i] = f(x[i], y) and the partial derivatives
+    // zx[i] = df/dx, zy[i] = df/dy. The default implementation
+    // uses central differences.
+    virtual void gradientRow(
+        const double* x, double y,
+        double* z, double* zx, double* zy, int n
+    ) const;
+};
+
+//
+// The radial cosine z = 0.5*cos(6*r) / (1 + r*r), r = sqrt(x*x + y*y).
+// The template can be evaluated both with double and Dual2.
+//
+template <class Real> inline Real radialCosine(const Real& x, const Real& y) {
+    Real r2 = x*x + y*y;
+    Real r = sqrt(r2);
+    return 0.5*cos(6.*r) / (1. + r2);
+}
+
+class RadialCosine: public SurfaceFunction {
+public:
+    virtual double value(double x, double y) const;
+    virtual void valueRow(
+        const double* x, double y, double* z, int n
+    ) const;
+    virtual bool hasGradient() const { return true; }
+    virtual void gradientRow(
+        const double* x, double y,
+        double* z, double* zx, double* zy, int n
+    ) const;
+};
+
+class SurfaceGrid {
+    // Data members
+public:
+    double  m_XMin;
+    double  m_YMin;
+    double  m_DX;
+    double  m_DY;
+    int     m_NX;           // Number of vertices along x-axis
+    int     m_NY;           //                   along y-axis
+
+    float*  m_Vertices;     // m_NX*m_NY vertices (x, y, z), row by row
+    float*  m_Normals;      // m_NX*m_NY unit normals (nx, ny, nz)
+
+    bool    m_ExactNormals; // Use the gradient of function, if it is known
+
+private:
+    double* m_X;            // x-coordinates of columns -1, 0, ..., m_NX
+
+    // The current evaluation
+    const SurfaceFunction* m_Function;
+
+    // Methods
+public:
+    SurfaceGrid();
+    ~SurfaceGrid();
+
+    // Define the grid covering [xmin, xmax]*[ymin, ymax] with steps dx, dy
+    void setDomain(
+        double xmin, double xmax,
+        double ymin, double ymax,
+        double dx, double dy
+    );
+
+    // Fill vertices and normals. If pool == 0, the default
+    // thread pool is used.
+    void evaluate(const SurfaceFunction& f, ThreadPool* pool = 0);
+
+    int numVertices() const { return m_NX * m_NY; }
+
+    const float* vertex(int i, int j) const {
+        return m_Vertices + 3*(j*m_NX + i);
+    }
+    const float* normal(int i, int j) const {
+        return m_Normals + 3*(j*m_NX + i);
+    }
+
+private:
+    SurfaceGrid(const SurfaceGrid&);              // Not implemented
+    SurfaceGrid& operator=(const SurfaceGrid&);   // Not implemented
+
+    void clear();
+    void evaluateBand(int band);
+    void evaluateBandWithGradient(int band);
+    static void bandTask(int band, void* grid);
+};
+
+#endif /* _SURFACE_GRID_H */
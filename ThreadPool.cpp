@@ -0,0 +1,118 @@
+//
+// File "ThreadPool.cpp"
+// Implementation of the class ThreadPool
+//
+#include <stdio.h>
+#include <unistd.h>
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int numThreads /* = 0 */):
+    m_NumThreads(numThreads),
+    m_Threads(0),
+    m_Generation(0),
+    m_BusyWorkers(0),
+    m_Terminate(false),
+    m_Task(0),
+    m_Context(0),
+    m_NumItems(0),
+    m_NextItem(0)
+{
+    if (m_NumThreads <= 0)
+        m_NumThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (m_NumThreads <= 0)
+        m_NumThreads = 1;
+
+    pthread_mutex_init(&m_Mutex, 0);
+    pthread_cond_init(&m_StartCond, 0);
+    pthread_cond_init(&m_DoneCond, 0);
+
+    if (m_NumThreads > 1) {
+        m_Threads = new pthread_t[m_NumThreads - 1];
+        for (int i = 0; i < m_NumThreads - 1; ++i) {
+            if (pthread_create(&(m_Threads[i]), 0, &workerProc, this) != 0) {
+                perror("Cannot create a worker thread");
+                m_NumThreads = i + 1;   // Work with the threads we have
+                break;
+            }
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    pthread_mutex_lock(&m_Mutex);
+    m_Terminate = true;
+    pthread_cond_broadcast(&m_StartCond);
+    pthread_mutex_unlock(&m_Mutex);
+
+    for (int i = 0; i < m_NumThreads - 1; ++i)
+        pthread_join(m_Threads[i], 0);
+    delete[] m_Threads;
+
+    pthread_cond_destroy(&m_DoneCond);
+    pthread_cond_destroy(&m_StartCond);
+    pthread_mutex_destroy(&m_Mutex);
+}
+
+ThreadPool& ThreadPool::defaultPool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::run(ParallelTask task, void* context, int numItems) {
+    if (numItems <= 0)
+        return;
+    if (m_NumThreads <= 1 || numItems == 1) {
+        for (int i = 0; i < numItems; ++i)
+            task(i, context);
+        return;
+    }
+
+    pthread_mutex_lock(&m_Mutex);
+    m_Task = task;
+    m_Context = context;
+    m_NumItems = numItems;
+    m_NextItem = 0;
+    m_BusyWorkers = m_NumThreads - 1;
+    ++m_Generation;
+    pthread_cond_broadcast(&m_StartCond);
+    pthread_mutex_unlock(&m_Mutex);
+
+    processItems();     // The calling thread works too
+
+    pthread_mutex_lock(&m_Mutex);
+    while (m_BusyWorkers > 0)
+        pthread_cond_wait(&m_DoneCond, &m_Mutex);
+    pthread_mutex_unlock(&m_Mutex);
+}
+
+void ThreadPool::processItems() {
+    while (true) {
+        int item = __sync_fetch_and_add(&m_NextItem, 1);
+        if (item >= m_NumItems)
+            break;
+        m_Task(item, m_Context);
+    }
+}
+
+void* ThreadPool::workerProc(void* p) {
+    ThreadPool* pool = (ThreadPool*) p;
+    unsigned int seenGeneration = 0;
+
+    pthread_mutex_lock(&(pool->m_Mutex));
+    while (true) {
+        while (!pool->m_Terminate && pool->m_Generation == seenGeneration)
+            pthread_cond_wait(&(pool->m_StartCond), &(pool->m_Mutex));
+        if (pool->m_Terminate)
+            break;
+        seenGeneration = pool->m_Generation;
+        pthread_mutex_unlock(&(pool->m_Mutex));
+
+        pool->processItems();
+
+        pthread_mutex_lock(&(pool->m_Mutex));
+        if (--(pool->m_BusyWorkers) == 0)
+            pthread_cond_signal(&(pool->m_DoneCond));
+    }
+    pthread_mutex_unlock(&(pool->m_Mutex));
+    return 0;
+}
@@ -0,0 +1,61 @@
+//
+// File "ThreadPool.h"
+//
+// The definition of the class ThreadPool,
+// a small pool of POSIX worker threads that executes
+// "parallel for" loops: a task function is called for every
+// item in the range [0, numItems), the items are distributed
+// dynamically among the workers and the calling thread.
+//
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+#include <pthread.h>
+
+// Task function: processes one item of a parallel loop
+typedef void (*ParallelTask)(int item, void* context);
+
+class ThreadPool {
+    // Data members
+private:
+    int             m_NumThreads;   // Number of threads including the caller
+    pthread_t*      m_Threads;      // Worker threads (m_NumThreads - 1)
+
+    pthread_mutex_t m_Mutex;
+    pthread_cond_t  m_StartCond;    // Signalled when a new loop starts
+    pthread_cond_t  m_DoneCond;     // Signalled when the last worker finishes
+
+    unsigned int    m_Generation;   // Incremented for every loop
+    int             m_BusyWorkers;  // Workers still running the current loop
+    bool            m_Terminate;
+
+    // The current loop
+    ParallelTask    m_Task;
+    void*           m_Context;
+    int             m_NumItems;
+    volatile int    m_NextItem;     // Next unprocessed item (atomic counter)
+
+    // Methods
+public:
+    // numThreads == 0 means "the number of online processors"
+    ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+
+    int numThreads() const { return m_NumThreads; }
+
+    // Call task(item, context) for all items in [0, numItems)
+    // and wait until all of them are processed
+    void run(ParallelTask task, void* context, int numItems);
+
+    // The pool shared by the whole application, created on demand
+    static ThreadPool& defaultPool();
+
+private:
+    ThreadPool(const ThreadPool&);              // Not implemented
+    ThreadPool& operator=(const ThreadPool&);   // Not implemented
+
+    void processItems();
+    static void* workerProc(void* pool);
+};
+
+#endif /* _THREAD_POOL_H */
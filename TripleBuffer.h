@@ -0,0 +1,77 @@
+//
+// File "TripleBuffer.h"
+//
+// The definition of the template class TripleBuffer, a lock-free
+// channel that passes the latest value of a state from one writer
+// thread to one reader thread (e.g. from a simulation thread to
+// the thread that draws the scene).
+//
+// There are three copies of the state: the writer fills the "back"
+// copy and publishes it, the reader works with the "front" copy,
+// and the third one holds the latest published value. Publishing
+// and taking the value are single atomic exchanges, so neither
+// thread ever waits for the other one. The writer may publish many
+// values between two reads; the reader gets only the newest one,
+// and a value it holds is never modified while it is used.
+//
+// Usage:
+//     Writer:                      Reader:
+//         State& s = tb.back();        if (tb.update())
+//         ... fill s ...                   draw(tb.front());
+//         tb.publish();
+//
+#ifndef _TRIPLE_BUFFER_H
+#define _TRIPLE_BUFFER_H
+
+template <class T> class TripleBuffer {
+    enum {
+        INDEX_MASK = 3,
+        FRESH = 4           // The middle copy is not yet read
+    };
+
+    // Data members
+    T               m_Buffers[3];
+    int             m_Back;         // Used by the writer only
+    int             m_Front;        // Used by the reader only
+    int             m_Middle;       // Index | FRESH, changed atomically
+
+public:
+    TripleBuffer():
+        m_Back(0),
+        m_Front(1),
+        m_Middle(2)
+    {}
+
+    // Initialize all copies (before the threads start)
+    void reset(const T& value) {
+        for (int i = 0; i < 3; ++i)
+            m_Buffers[i] = value;
+        m_Back = 0; m_Front = 1; m_Middle = 2;
+    }
+
+    // Writer: the copy to fill, then publish it
+    T& back() { return m_Buffers[m_Back]; }
+    void publish() {
+        int old = __atomic_exchange_n(
+            &m_Middle, m_Back | FRESH, __ATOMIC_ACQ_REL
+        );
+        m_Back = (old & INDEX_MASK);
+    }
+
+    // Reader: take the latest published copy, if there is a new one.
+    // Returns false if nothing was published since the last update.
+    bool update() {
+        if ((__atomic_load_n(&m_Middle, __ATOMIC_ACQUIRE) & FRESH) == 0)
+            return false;
+        int old = __atomic_exchange_n(&m_Middle, m_Front, __ATOMIC_ACQ_REL);
+        m_Front = (old & INDEX_MASK);
+        return true;
+    }
+    const T& front() const { return m_Buffers[m_Front]; }
+
+private:
+    TripleBuffer(const TripleBuffer&);              // Not implemented
+    TripleBuffer& operator=(const TripleBuffer&);   // Not implemented
+};
+
+#endif /* _TRIPLE_BUFFER_H */
@@ -0,0 +1,69 @@
+//
+// File "ViewVolume.cpp"
+// Implementation of the classes R3Box and ViewVolume
+//
+#include <math.h>
+#include "ViewVolume.h"
+
+void R3Box::add(double x, double y, double z) {
+    if (x < xMin) xMin = x;
+    if (x > xMax) xMax = x;
+    if (y < yMin) yMin = y;
+    if (y > yMax) yMax = y;
+    if (z < zMin) zMin = z;
+    if (z > zMax) zMax = z;
+}
+
+//
+// The center of box is transformed exactly; the half sizes of the
+// eye-space box are sums of the half sizes multiplied by the absolute
+// values of the matrix elements, so the new box contains all corners.
+//
+bool ViewVolume::visible(const GLfloat m[16], const R3Box& b) const {
+    double c[3], h[3];
+    c[0] = (b.xMin + b.xMax) * 0.5; h[0] = (b.xMax - b.xMin) * 0.5;
+    c[1] = (b.yMin + b.yMax) * 0.5; h[1] = (b.yMax - b.yMin) * 0.5;
+    c[2] = (b.zMin + b.zMax) * 0.5; h[2] = (b.zMax - b.zMin) * 0.5;
+
+    double eyeMin[3], eyeMax[3];
+    for (int i = 0; i < 3; ++i) {
+        // Row i of the matrix: m[i], m[4 + i], m[8 + i], m[12 + i]
+        double center = m[12 + i];
+        double half = 0.;
+        for (int j = 0; j < 3; ++j) {
+            center += m[4*j + i] * c[j];
+            half += fabs(m[4*j + i]) * h[j];
+        }
+        eyeMin[i] = center - half;
+        eyeMax[i] = center + half;
+    }
+    return (
+        eyeMax[0] >= m_Box.xMin && eyeMin[0] <= m_Box.xMax &&
+        eyeMax[1] >= m_Box.yMin && eyeMin[1] <= m_Box.yMax &&
+        eyeMax[2] >= m_Box.zMin && eyeMin[2] <= m_Box.zMax
+    );
+}
+
+bool ViewVolume::visible(
+    const GLfloat m[16], const BoundingSphere& s
+) const {
+    double e[3];
+    double scale2 = 0.;
+    for (int i = 0; i < 3; ++i) {
+        e[i] = m[12 + i];
+        for (int j = 0; j < 3; ++j)
+            e[i] += m[4*j + i] * s.center[j];
+
+        // Length of column i: the scale along the axis i
+        double len2 =
+            m[4*i]*m[4*i] + m[4*i + 1]*m[4*i + 1] + m[4*i + 2]*m[4*i + 2];
+        if (len2 > scale2)
+            scale2 = len2;
+    }
+    double r = s.radius * sqrt(scale2);
+    return (
+        e[0] + r >= m_Box.xMin && e[0] - r <= m_Box.xMax &&
+        e[1] + r >= m_Box.yMin && e[1] - r <= m_Box.yMax &&
+        e[2] + r >= m_Box.zMin && e[2] - r <= m_Box.zMax
+    );
+}
@@ -0,0 +1,73 @@
+//
+// File "ViewVolume.h"
+//
+// Culling of objects outside the view volume on the CPU side.
+//
+// R3Box is an axis-aligned box: an R2Rectangle (for example, the domain
+// of a surface z = f(x, y), or a window rectangle) extended along
+// the z-axis. BoundingSphere is the sphere around an object.
+//
+// ViewVolume is the orthographic view volume of GLWindow in eye
+// coordinates: the window coordinate rectangle and the depth range
+// given to glOrtho. An object is tested with the modelview matrix
+// that is used to draw it: its bounds are transformed to eye
+// coordinates (conservatively, a box becomes a larger axis-aligned
+// box, a sphere is scaled by the largest scale of the matrix) and
+// compared with the volume. So an object reported invisible surely
+// lies outside, and a visible one may still be clipped by OpenGL.
+//
+#ifndef _VIEW_VOLUME_H
+#define _VIEW_VOLUME_H
+
+#include <GL/gl.h>
+#include "GWindow/R2Graph/R2Graph.h"
+
+class R3Box {
+public:
+    double xMin, xMax;
+    double yMin, yMax;
+    double zMin, zMax;
+
+    R3Box():
+        xMin(0.), xMax(0.),
+        yMin(0.), yMax(0.),
+        zMin(0.), zMax(0.)
+    {}
+
+    R3Box(const R2Rectangle& r, double _zMin, double _zMax):
+        xMin(r.left()), xMax(r.right()),
+        yMin(r.bottom()), yMax(r.top()),
+        zMin(_zMin), zMax(_zMax)
+    {}
+
+    // Extend the box to contain the point
+    void add(double x, double y, double z);
+};
+
+struct BoundingSphere {
+    GLfloat center[3];
+    GLfloat radius;
+};
+
+class ViewVolume {
+    R3Box   m_Box;          // In eye coordinates
+
+public:
+    ViewVolume():
+        m_Box()
+    {}
+
+    // The volume of glOrtho(left, right, bottom, top, zNear, zFar)
+    void setOrtho(const R2Rectangle& r, double zNear, double zFar) {
+        m_Box = R3Box(r, -zFar, -zNear);
+    }
+    const R3Box& box() const { return m_Box; }
+
+    // Tests with the modelview matrix (column-major, as glGetFloatv)
+    bool visible(const GLfloat modelview[16], const R3Box& b) const;
+    bool visible(
+        const GLfloat modelview[16], const BoundingSphere& s
+    ) const;
+};
+
+#endif /* _VIEW_VOLUME_H */
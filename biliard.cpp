@@ -1,55 +1,72 @@
 #include <unistd.h>
-#include <time.h>
-#include <sys/times.h>
 #include <sys/types.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 
 #include "GLWindow.h"
-	bool chcolor;
+#include "Simulation.h"
+#include "TripleBuffer.h"
 
 static const GLfloat XMaxAbs=0.9;
 static const GLfloat YMaxAbs=0.7;
 
-static clock_t clocks_per_sec = 100;            // To be initialized...
-static const int SLEEP_USEC = 10000;           // Sleep 0.1 sec
+static const double STEP_TIME = 0.01;           // Simulation step 0.01 sec
 static const GLfloat BallRadius = 0.1;
+static const double FRAME_RATE = 60.;          // Frames per second
 static bool finished = false;
 
+// A snapshot of the simulation: everything needed to draw the ball
+struct BallState {
+    GLfloat x;
+    GLfloat y;
+    bool    blue;           // Color changes when the ball bounces
+};
+
+// The ball is moved by the simulation thread
+class BallSimulation: public Simulation {
+    BallState   m_State;    // Used by the simulation thread only
+    GLfloat     m_VeloX;    // Per step
+    GLfloat     m_VeloY;
+    TripleBuffer<BallState> m_Snapshots;
+
+public:
+    BallSimulation();
+    virtual ~BallSimulation() { stop(); }
+
+    TripleBuffer<BallState>& snapshots() { return m_Snapshots; }
+
+protected:
+    virtual void step(double dt);
+};
+
+// The ball is drawn as an impostor, when the shaders are available.
+// Otherwise its sphere is compiled once into a display list,
+// that is shared by the contexts of all views
+static bool useImpostors = true;
+static GLuint ballList = 0;
+
 class MyWindow: public GLWindow {  // Our main class derived from GLWindow
-    GLUquadricObj*  m_Quadric;  // Quadric object used to draw a sphere
     GLfloat         m_Alpha;    // Angle of rotation around vert.axis in degrees
     GLfloat         m_Beta;     // Angle of rotation around hor.axis in degrees
     I2Point         m_MousePos; // Previous position of mouse pointer
 	GLfloat 		AlphaV [3];
 	GLfloat 		BetaV  [3];
 
-	
-    // Animation
-    GLfloat			BallX;
-    GLfloat			BallY;
-    GLfloat 		VeloX;
-	GLfloat 		VeloY;
-
-    clock_t m_AnimationTime; // A previous moment "animate" has been called at
+    // Animation, common for all views
+    BallSimulation* m_Simulation;
 
 public:
-    MyWindow():             // Constructor
+    MyWindow(               // Constructor
+        BallSimulation* simulation,
+        GLfloat alpha = 0., GLfloat beta = 10.  // Camera
+    ):
         GLWindow(),
-        m_Quadric(0),
-
-        m_Alpha(0.),
-        m_Beta(10.),
+        m_Alpha(alpha),
+        m_Beta(beta),
         m_MousePos(-1, -1),
-        BallX(0.),
-        BallY(0.),
-        VeloX(0.02),
-        VeloY(0.02),
-        m_AnimationTime(0)
+        m_Simulation(simulation)
     {}
-    
-    void animate();
 
     void drawScene();       // Draw a scene graph
     void render();          // Render a 3D object
@@ -96,72 +113,58 @@ void MyWindow::drawScene() {
     GLfloat pos[4];
     pos[0] = 0.; pos[1] = 0.; pos[2] = 10.;
     pos[3] = 0.;                // Directional light
-    glLightfv(GL_LIGHT0, GL_POSITION, pos);
 
     // Color
-    GLfloat color[4];
-    color[0] = 0.25; color[1] = 0.25; color[2] = 0.25; color[3] = 1.;
-    glLightfv(GL_LIGHT0, GL_AMBIENT, color);
-    color[0] = 1.; color[1] = 1.; color[2] = 1.;
-    glLightfv(GL_LIGHT0, GL_DIFFUSE, color);
-    color[2] = 1.;
-    glLightfv(GL_LIGHT0, GL_SPECULAR, color);
+    GLfloat ambient[4], color[4];
+    ambient[0] = 0.25; ambient[1] = 0.25; ambient[2] = 0.25; ambient[3] = 1.;
+    color[0] = 1.; color[1] = 1.; color[2] = 1.; color[3] = 1.;
+    setLight(pos, ambient, color, color);
 
     render();           // Draw all 3D objects
 
     swapBuffers();
 }
 
-void MyWindow::animate() {
-    clock_t curtime = times(0);
-    if (m_AnimationTime == 0) {
-        // The first call
-        m_AnimationTime = curtime;
-        return;
-    }
-
-    clock_t dt = curtime - m_AnimationTime;
-    if (dt >= SLEEP_USEC*clocks_per_sec/1000000) {
-        // printf("Animation, curtime = %d\n", (int) curtime);
-        //GLfloat Dt = (GLfloat) dt / (GLfloat) clocks_per_sec; // in sec	
-		if (VeloX>0)
-			if (BallX+VeloX<=XMaxAbs)
-				BallX+=VeloX;
-			else {
-				BallX=BallX+VeloX-2*(BallX+VeloX-XMaxAbs);
-				VeloX*=-1;
-				chcolor = 1;
-				}
-		else  //v<0
-			if (BallX+VeloX>=-XMaxAbs)
-				BallX+=VeloX;
-			else {
-				BallX=BallX+VeloX+2*(-BallX-VeloX-XMaxAbs);
-				VeloX*=-1;
-				chcolor = 0;
-				}	
-				
-		if (VeloY>0)		
-			if (BallY+VeloY<=YMaxAbs)
-				BallY+=VeloY;			
-			else {
-				BallY=BallY+VeloY-2*(BallY+VeloY-YMaxAbs);
-				VeloY*=-1;
-				chcolor = 0;
-				}
-		else  //v<0
-			if (BallY+VeloY>=-YMaxAbs)
-				BallY+=VeloY;
-			else {
-				BallY=BallY+VeloY+2*(-BallY-VeloY-YMaxAbs);
-				VeloY*=-1;
-				chcolor = 0;
-				}	
-	
-	drawScene();
+BallSimulation::BallSimulation():
+    Simulation(STEP_TIME),
+    m_VeloX(0.02),
+    m_VeloY(0.02)
+{
+    m_State.x = 0.;
+    m_State.y = 0.;
+    m_State.blue = false;
+    m_Snapshots.reset(m_State);
+}
 
-        m_AnimationTime = curtime;
+// The velocity is given per step, the ball bounces off the cushions
+void BallSimulation::step(double /* dt */) {
+    GLfloat x = m_State.x + m_VeloX;
+    if (x > XMaxAbs) {
+        x = 2*XMaxAbs - x;
+        m_VeloX = -m_VeloX;
+        m_State.blue = true;
+    } else if (x < -XMaxAbs) {
+        x = (-2)*XMaxAbs - x;
+        m_VeloX = -m_VeloX;
+        m_State.blue = false;
+    }
+    m_State.x = x;
+
+    GLfloat y = m_State.y + m_VeloY;
+    if (y > YMaxAbs) {
+        y = 2*YMaxAbs - y;
+        m_VeloY = -m_VeloY;
+        m_State.blue = false;
+    } else if (y < -YMaxAbs) {
+        y = (-2)*YMaxAbs - y;
+        m_VeloY = -m_VeloY;
+        m_State.blue = false;
     }
+    m_State.y = y;
+
+    m_Snapshots.back() = m_State;
+    m_Snapshots.publish();
+    GWindow::wakeUp();          // The drawing thread will take it
 }
 
 void MyWindow::onKeyPress(XEvent& event) {
@@ -175,6 +178,26 @@ void MyWindow::onKeyPress(XEvent& event) {
         printf("\"%s\" button pressed.\n", keyName);
         if (keyName[0] == 'q') { // quit => close window
             destroyWindow();
+        } else if (keyName[0] == 'r') { // dynamic resolution on/off
+            if (dynamicResolution() != 0)
+                setDynamicResolution(0.);
+            else if (!setDynamicResolution(1. / FRAME_RATE))
+                printf("Dynamic resolution is not supported\n");
+        } else if (keyName[0] == 'p') { // pause/continue animation
+            m_Simulation->setPaused(!m_Simulation->paused());
+        } else if (keyName[0] == 'c') { // start/stop recording
+            if (capture() != 0 && capture()->active())
+                stopCapture();
+            else if (startCapture("biliard.y4m"))
+                printf("Recording to biliard.y4m\n");
+        } else if (keyName[0] == 'i') { // impostor/polygonal ball
+            useImpostors = !useImpostors;
+            printf(
+                "Ball: %s\n",
+                (useImpostors && shadersEnabled())?
+                    "impostor" : "gluSphere"
+            );
+            redraw();
         }
     }
 }
@@ -227,8 +250,7 @@ void MyWindow::render(){
 	
 	
 	color[0] = 0.5; color[1] = 0.8; color[2] = 0.3; color[3] = 1.;
-    glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
-    glMaterialf(GL_FRONT, GL_SHININESS, 0.3);
+    setMaterial(color, 0.3);
     
     glBegin(GL_TRIANGLES);
 		normal[0] = 0.;
@@ -294,33 +316,58 @@ void MyWindow::render(){
     
 	
     // Draw Ball
-    if (m_Quadric == 0) {
-        m_Quadric = gluNewQuadric();    // Create a Quadric object
-        gluQuadricNormals(m_Quadric, GLU_SMOOTH);
-    }
-    if (chcolor){color[0] = 0.; color[1] = 0.; color[2] = 1.; color[3] = 1.;}else 
+    const BallState& ball = m_Simulation->snapshots().front();
+    if (ball.blue){color[0] = 0.; color[1] = 0.; color[2] = 1.; color[3] = 1.;}else 
     {color[0] = 1.; color[1] = 0.; color[2] = 0.; color[3] = 1.;}
-    glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
-    glMaterialf(GL_FRONT, GL_SHININESS, 0.3);
-    
-    glTranslatef(BallX,BallY,BallRadius);
-    
-    gluSphere(
-        m_Quadric, 
-        BallRadius,
-        180,     // Num. slices (similar to lines of longitude)
-        109      // Num. stacks (similar to lines of latitude)
-    );
+    setMaterial(color, 0.3);
+
+    SphereImpostors* impostors = (useImpostors)? sphereImpostors() : 0;
+    if (impostors != 0) {
+        impostors->begin();
+        impostors->draw(ball.x, ball.y, BallRadius, BallRadius);
+        impostors->end();
+        return;
+    }
+
+    if (ballList == 0) {
+        GLUquadricObj* quadric = gluNewQuadric();   // Create a Quadric object
+        gluQuadricNormals(quadric, GLU_SMOOTH);
+        ballList = glGenLists(1);
+        glNewList(ballList, GL_COMPILE);
+        gluSphere(
+            quadric, 
+            BallRadius,
+            180,     // Num. slices (similar to lines of longitude)
+            109      // Num. stacks (similar to lines of latitude)
+        );
+        glEndList();
+        gluDeleteQuadric(quadric);
+    }
+    glTranslatef(ball.x,ball.y,BallRadius);
     
-    gluQuadricDrawStyle(m_Quadric, GLU_FILL); // Restore the normal draw style
+    glCallList(ballList);
 }
 
-int main() {
+//
+// Usage: biliard [numViews]
+// The table is shown in 1-3 windows: the main view, the player view
+// and the side view. All views show the same simulation and are drawn
+// together by the scheduler of GLWindow.
+//
+int main(int argc, char* argv[]) {
     XEvent e;
 
+    int numViews = 1;
+    if (argc > 1)
+        numViews = atoi(argv[1]);
+    if (numViews < 1)
+        numViews = 1;
+    else if (numViews > 3)
+        numViews = 3;
+
     // Initialize X stuff
-    if (!GWindow::initX()) {
-        printf("Could not connect to X-server.\n");
+    if (!GLWindow::initGraphics()) {
+        printf("Could not initialize graphics.\n");
         exit(1);
     }
 
@@ -328,49 +375,72 @@ int main() {
     int height = GWindow::screenMaxY()/2;
     double aspect = (double) width / (double) height;
 
-    MyWindow w;
-    w.createWindow(
-        I2Rectangle(                    // Window frame rectangle:
-            I2Point(10, 10),            //     left-top corner,
-            width, height               //     width, height
-        ),
-        R2Rectangle(                        // Window coordinate rectangle
-            R2Point(-1.3 * aspect, -1.3),   //     left-top corner,
-            2.6 * aspect, 2.6               //     width, height
-        ),
-        "OpenGL Table"                   // Window title
-    );
-    w.setBackground("lightGray");
-    w.makeCurrent();
-    GLWindow::initializeOpenGL();
-
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    // a perspective-view matrix...
-    glViewport(0, 0, width, height);
-    glOrtho(
-        -1.3 * aspect, 1.3 * aspect,    // left, right
-        -1.3, 1.3,                      // bottom, top,
-        -2., 2.                         // near, far
-    );
-    clocks_per_sec = (time_t) sysconf(_SC_CLK_TCK);
-
-    // Message loop, animation
+    static const GLfloat cameras[3][2] = {  // Alpha, beta
+        { 0., 10. }, { 0., -60. }, { 60., -30. }
+    };
+    static const char* titles[3] = {
+        "OpenGL Table", "OpenGL Table: player view", "OpenGL Table: side view"
+    };
+
+    BallSimulation simulation;
+    MyWindow* views[3];
+    for (int i = 0; i < numViews; ++i) {
+        views[i] = new MyWindow(&simulation, cameras[i][0], cameras[i][1]);
+        MyWindow& w = *(views[i]);
+        w.createWindow(
+            I2Rectangle(                    // Window frame rectangle:
+                I2Point(10 + 40*i, 10 + 40*i),  // left-top corner,
+                width, height               //     width, height
+            ),
+            R2Rectangle(                        // Window coordinate rectangle
+                R2Point(-1.3 * aspect, -1.3),   //     left-top corner,
+                2.6 * aspect, 2.6               //     width, height
+            ),
+            titles[i]                       // Window title
+        );
+        w.setBackground("lightGray");
+        w.makeCurrent();
+        GLWindow::initializeOpenGL();
+
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        // a perspective-view matrix...
+        glViewport(0, 0, width, height);
+        glOrtho(
+            -1.3 * aspect, 1.3 * aspect,    // left, right
+            -1.3, 1.3,                      // bottom, top,
+            -2., 2.                         // near, far
+        );
+
+        // The views are drawn by GLWindow::renderDirtyWindows()
+        w.setRedrawDeferred(true);
+    }
+
+    // Message loop. This thread handles the events and draws the scene,
+    // the ball is moved by the simulation thread. Only the main view
+    // waits for the vertical retrace.
+    views[0]->setFrameRate(FRAME_RATE);
+    GLWindow::setSchedulerFrameRate(FRAME_RATE);
+    simulation.start();
     while (!finished) {
         if (GLWindow::getNextEvent(e)) {
             GLWindow::dispatchEvent(e);
-        } else {
-
-            // Sleep a bit (we use select for sleeping)
-            timeval dt;
-            dt.tv_sec = 0;
-            dt.tv_usec = 10000; // sleeping time 0.01 sec
-            select(1, 0, 0, 0, &dt);
-
-            w.animate();
+        } else if (simulation.snapshots().update()) {
+            for (int i = 0; i < numViews; ++i)
+                views[i]->redraw();
+        } else if (GLWindow::renderDirtyWindows() == 0) {
+            // Sleep until an event comes or the ball moves
+            GWindow::waitEvent();
         }
     }
-
+    simulation.stop();
+    printFrameTimeStats(views[0]->frameTimeStats());
+    const DynamicResolution* dr = views[0]->dynamicResolution();
+    if (dr != 0)
+        printf("Resolution scale %.3f\n", dr->scale());
+
+    for (int i = 0; i < numViews; ++i)
+        delete views[i];
     GWindow::closeX();
     return 0;
 }
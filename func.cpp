@@ -13,6 +13,12 @@
 #include <stdlib.h>
 #include <math.h>
 #include "GLWindow.h"
+#include "SurfaceGrid.h"
+#include "AdaptiveSurface.h"
+
+static double gridStep = 0.05;      // Step of the surface grid
+static const int TILE_CELLS = 16;   // Grid cells along a side of tile
+static double tolerance = 0.002;    // Tolerance of adaptive tessellation
 
 //--------------------------------------------------
 // Definition of class "MyWindow"
@@ -22,18 +28,39 @@ class MyWindow: public GLWindow {  // Our main class derived from GLWindow
     GLfloat         m_Alpha;    // Angle of rotation around vert.axis in degrees
     GLfloat         m_Beta;     // Angle of rotation around hor.axis in degrees
     I2Point         m_MousePos; // Previous position of mouse pointer
+    RadialCosine    m_Function; // The function z = f(x, y)
+    SurfaceGrid     m_Surface;  // Its vertices and normals
+    bool            m_SurfaceComputed;
+    R3Box*          m_Tiles;    // Bounding boxes of tiles of the grid,
+    int             m_NumTilesX;    //     culled by the view volume
+    int             m_NumTilesY;
+    AdaptiveSurface m_Adaptive; // Adaptive triangulation of the surface
+    bool            m_AdaptiveComputed;
+    bool            m_UseAdaptive;
 public:
     MyWindow():                 // Constructor
         GLWindow(),
         m_Quadric(0),
         m_Alpha(0.),
         m_Beta(0.),
-        m_MousePos(-1, -1)
+        m_MousePos(-1, -1),
+        m_Function(),
+        m_Surface(),
+        m_SurfaceComputed(false),
+        m_Tiles(0),
+        m_NumTilesX(0),
+        m_NumTilesY(0),
+        m_Adaptive(),
+        m_AdaptiveComputed(false),
+        m_UseAdaptive(false)
     {}
+    virtual ~MyWindow() { delete[] m_Tiles; }
 
     double f(double x, double y);       // Draw a scene graph
-    void gradient(double x, double y, GLfloat grad[3]);
     void render();                      // Draw a scene graph
+    void drawVertex(int i, int j);      // Vertex (i, j) of the surface
+    void computeTiles();
+    void drawAdaptiveSurface();
     void setColor(double z);
 
     virtual void onExpose(XEvent& event);
@@ -44,37 +71,18 @@ public:
 };
 
 double MyWindow::f(double x, double y) {
-    double r = sqrt(x*x+y*y);
-    return (
-        0.5*cos(6.*r) /
-        (1. + r*r)
-    );
-}
-
-void MyWindow::gradient(double x, double y, GLfloat grad[3]) {
-    // z = f(x, y)
-    // F(x, y, z) = z - f(x, y)
-    double dx = 0.0001;
-    double dy = 0.0001;
-    double dFx = -(f(x+dx, y) - f(x-dx, y)) / (2.*dx);
-    double dFy = -(f(x, y+dy) - f(x, y-dy)) / (2.*dy);
-    double dFz = 1.;
-    double len = sqrt(dFx*dFx + dFy*dFy + dFz*dFz);
-    if (len <= 0.)
-        len = 0.;
-    grad[0] = (GLfloat)(dFx / len);
-    grad[1] = (GLfloat)(dFy / len);
-    grad[2] = (GLfloat)(dFz / len);
+    return m_Function.value(x, y);
 }
 
 void MyWindow::setColor(double z) {
-    GLfloat color[3];
+    GLfloat color[4];
     double c = 0.5 + atan(2.*z) / M_PI;
 
     color[0] = 0.1 + c * 0.9;   // Red
     color[1] = 0.2 + c * 0.4;   // Green
     color[2] = 1.0 - c * 0.8;;  // Blue
-    glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
+    color[3] = 1.;
+    setVertexColor(color);
 }
 
 //
@@ -120,6 +128,10 @@ void MyWindow::onKeyPress(XEvent& event) {
         printf("\"%s\" button pressed.\n", keyName);
         if (keyName[0] == 'q') { // quit => close window
             destroyWindow();
+        } else if (keyName[0] == 'a') {
+            // Switch between the uniform grid and adaptive tessellation
+            m_UseAdaptive = !m_UseAdaptive;
+            redraw();
         } else {
             // Set initial position.
             m_Alpha = 0.;
@@ -189,11 +201,15 @@ void MyWindow::render() {
     glClearColor(0.2, 0.3, 0.5, 1.); // Background color: dark blue
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    // The colors of axes and surface are given per vertex
+    color[0] = 1.; color[1] = 1.; color[2] = 1.; color[3] = 1.;
+    setMaterial(color);
+
     // Coordinate system
     glBegin(GL_LINES);
         // X-axis
         color[0] = 1.0; color[1] = 0.2; color[2] = 0.2;  // Red
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
+        setVertexColor(color);
 
         normal[0] = 0.;
         normal[1] = 0.;
@@ -204,7 +220,7 @@ void MyWindow::render() {
 
         // Y-axis
         color[0] = 0.3; color[1] = 1.0; color[2] = 0.2;  // Green
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
+        setVertexColor(color);
 
         //... normal[0] = 0.;
         //... normal[1] = 0.;
@@ -215,7 +231,7 @@ void MyWindow::render() {
 
         // Z-axis
         color[0] = 0.1; color[1] = 0.3; color[2] = 1.0;  // Blue
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
+        setVertexColor(color);
 
         normal[0] = 1.;
         normal[1] = 0.;
@@ -227,66 +243,128 @@ void MyWindow::render() {
 
 
     // Draw a graph of function z = f(x, y)
+    if (m_UseAdaptive) {
+        drawAdaptiveSurface();
+        return;
+    }
+
+    if (!m_SurfaceComputed) {
+        // The grid is computed once, the rotation does not change it
+        m_Surface.setDomain(
+            -2.5, 2.5,              // xmin, xmax
+            -2.5, 2.5,              // ymin, ymax
+            gridStep, gridStep      // dx, dy
+        );
+        m_Surface.evaluate(m_Function);
+        m_SurfaceComputed = true;
+        computeTiles();
+    }
+
+    // The matrix cannot be read between glBegin and glEnd
+    GLfloat modelview[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+
     glBegin(GL_TRIANGLES);
-        double xmin = -2.5;
-        double xmax = 2.5;
-        double ymin = -2.5;
-        double ymax = 2.5;
-        double dx = 0.05;
-        double dy = 0.05;
-
-        //... color[0] = 0.6; color[1] = 0.5; color[2] = 0.4;
-        //... glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
-        //...
-        //... normal[0] = 0.;
-        //... normal[1] = 0.;
-        //... normal[2] = 1.;
-        //... glNormal3fv(normal);
+    for (int ty = 0; ty < m_NumTilesY; ++ty) {
+        for (int tx = 0; tx < m_NumTilesX; ++tx) {
+            bool v = viewVolume().visible(
+                modelview, m_Tiles[ty*m_NumTilesX + tx]
+            );
+            countCulling(v);
+            if (!v)
+                continue;
+
+            int jMax = (ty + 1) * TILE_CELLS;
+            if (jMax > m_Surface.m_NY - 1)
+                jMax = m_Surface.m_NY - 1;
+            int iMax = (tx + 1) * TILE_CELLS;
+            if (iMax > m_Surface.m_NX - 1)
+                iMax = m_Surface.m_NX - 1;
+            for (int j = ty * TILE_CELLS; j < jMax; ++j) {
+                for (int i = tx * TILE_CELLS; i < iMax; ++i) {
+                    drawVertex(i, j);
+                    drawVertex(i+1, j);
+                    drawVertex(i+1, j+1);
+
+                    //----------------------------
+
+                    drawVertex(i, j);
+                    drawVertex(i+1, j+1);
+                    drawVertex(i, j+1);
+                }
+            }
+        }
+    }
+    glEnd();
+}
 
-        double y = ymin;
-        while (y < ymax) {
-            double x = xmin;
-            while (x < xmax) {
-                double z00 = f(x, y);
-                double z10 = f(x+dx, y);
-                double z01 = f(x, y+dy);
-                double z11 = f(x+dx, y+dy);
-
-                gradient(x, y, normal);
-                glNormal3fv(normal);
-                setColor(z00);
-                glVertex3f(x, y, z00);
-
-                gradient(x+dx, y, normal);
-                glNormal3fv(normal);
-                setColor(z10);
-                glVertex3f(x+dx, y, z10);
-
-                gradient(x+dx, y+dy, normal);
-                glNormal3fv(normal);
-                setColor(z11);
-                glVertex3f(x+dx, y+dy, z11);
-
-                //----------------------------
-
-                gradient(x, y, normal);
-                glNormal3fv(normal);
-                setColor(z00);
-                glVertex3f(x, y, z00);
-
-                gradient(x+dx, y+dy, normal);
-                glNormal3fv(normal);
-                setColor(z11);
-                glVertex3f(x+dx, y+dy, z11);
-
-                gradient(x, y+dy, normal);
-                glNormal3fv(normal);
-                setColor(z01);
-                glVertex3f(x, y+dy, z01);
-
-                x += dx;
+//
+// The grid is divided into tiles of TILE_CELLS x TILE_CELLS cells.
+// The box of a tile is the rectangle of its domain extended
+// to the range of z on its vertices.
+//
+void MyWindow::computeTiles() {
+    int numCellsX = m_Surface.m_NX - 1;
+    int numCellsY = m_Surface.m_NY - 1;
+    m_NumTilesX = (numCellsX + TILE_CELLS - 1) / TILE_CELLS;
+    m_NumTilesY = (numCellsY + TILE_CELLS - 1) / TILE_CELLS;
+    delete[] m_Tiles;
+    m_Tiles = new R3Box[m_NumTilesX * m_NumTilesY];
+
+    for (int ty = 0; ty < m_NumTilesY; ++ty) {
+        int j0 = ty * TILE_CELLS;
+        int j1 = (j0 + TILE_CELLS < numCellsY)? j0 + TILE_CELLS : numCellsY;
+        for (int tx = 0; tx < m_NumTilesX; ++tx) {
+            int i0 = tx * TILE_CELLS;
+            int i1 =
+                (i0 + TILE_CELLS < numCellsX)? i0 + TILE_CELLS : numCellsX;
+            const float* v0 = m_Surface.vertex(i0, j0);
+            const float* v1 = m_Surface.vertex(i1, j1);
+            R3Box box(
+                R2Rectangle(v0[0], v0[1], v1[0] - v0[0], v1[1] - v0[1]),
+                v0[2], v0[2]
+            );
+            for (int j = j0; j <= j1; ++j) {
+                for (int i = i0; i <= i1; ++i) {
+                    const float* v = m_Surface.vertex(i, j);
+                    box.add(v[0], v[1], v[2]);
+                }
             }
-            y += dy;
+            m_Tiles[ty*m_NumTilesX + tx] = box;
+        }
+    }
+}
+
+void MyWindow::drawVertex(int i, int j) {
+    const float* v = m_Surface.vertex(i, j);
+    glNormal3fv(m_Surface.normal(i, j));
+    setColor(v[2]);
+    glVertex3fv(v);
+}
+
+void MyWindow::drawAdaptiveSurface() {
+    if (!m_AdaptiveComputed) {
+        m_Adaptive.build(
+            m_Function,
+            -2.5, 2.5,              // xmin, xmax
+            -2.5, 2.5,              // ymin, ymax
+            tolerance
+        );
+        m_AdaptiveComputed = true;
+        printf(
+            "Adaptive surface: %d vertices, %d triangles\n",
+            m_Adaptive.numVertices(), m_Adaptive.numTriangles()
+        );
+    }
+
+    glBegin(GL_TRIANGLES);
+        int n = 3 * m_Adaptive.numTriangles();
+        for (int i = 0; i < n; ++i) {
+            int k = m_Adaptive.m_Triangles[i];
+            const float* v = m_Adaptive.vertex(k);
+            glNormal3fv(m_Adaptive.normal(k));
+            setColor(v[2]);
+            glVertex3fv(v);
         }
     glEnd();
 }
@@ -294,10 +372,18 @@ void MyWindow::render() {
 /////////////////////////////////////////////////////////////
 // Main: initialize X, create an instance of MyWindow class,
 //       and start the message loop
-int main() {
+//
+// Usage: func [gridStep [tolerance]]
+// Press "a" to switch to the adaptive tessellation and back
+int main(int argc, char* argv[]) {
+    if (argc > 1 && atof(argv[1]) > 0.)
+        gridStep = atof(argv[1]);
+    if (argc > 2 && atof(argv[2]) > 0.)
+        tolerance = atof(argv[2]);
+
     // Initialize X stuff
-    if (!GWindow::initX()) {
-        printf("Could not connect to X-server.\n");
+    if (!GLWindow::initGraphics()) {
+        printf("Could not initialize graphics.\n");
         exit(1);
     }
 
@@ -10,14 +10,14 @@
 //
 //                                      Written by V.Borisenko
 #include <unistd.h>
-#include <time.h>
-#include <sys/times.h>
 #include <sys/types.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 
 #include "GLWindow.h"
+#include "Simulation.h"
+#include "TripleBuffer.h"
 
 static const GLfloat EARTH_RADIUS = 0.3;
 
@@ -27,11 +27,33 @@ static const GLfloat MOON_ROTATION_SPEED = 4.;  // Orbit speed in degrees/sec
 static const GLfloat MOON_SPIN_SPEED = 4.;      // Rotation speed
 static const GLfloat EARTH_SPIN_SPEED = 12.;
 
-static clock_t clocks_per_sec = 100;            // To be initialized...
-static const int SLEEP_USEC = 100000;           // Sleep 0.1 sec
+static const double STEP_TIME = 0.02;           // Simulation step 0.02 sec
 
+static const double FRAME_RATE = 60.;          // Frames per second
 static bool finished = false;
 
+// A snapshot of the simulation: positions of the bodies
+struct MoonState {
+    GLfloat earthSpin;      // Angle of Earth rotation
+    GLfloat moonAlpha;      // Moon orbit position
+    GLfloat moonSpin;       // Angle of Moon rotation
+};
+
+// The bodies are moved by the simulation thread
+class MoonSimulation: public Simulation {
+    MoonState   m_State;    // Used by the simulation thread only
+    TripleBuffer<MoonState> m_Snapshots;
+
+public:
+    MoonSimulation();
+    virtual ~MoonSimulation() { stop(); }
+
+    TripleBuffer<MoonState>& snapshots() { return m_Snapshots; }
+
+protected:
+    virtual void step(double dt);
+};
+
 //--------------------------------------------------
 // Definition of class "MyWindow"
 //
@@ -42,10 +64,7 @@ class MyWindow: public GLWindow {  // Our main class derived from GLWindow
     I2Point         m_MousePos; // Previous position of mouse pointer
 
     // Animation
-    GLfloat m_EarthSpin;     // Angle of Earth rotation
-    GLfloat m_MoonAlpha;     // Moon orbit position
-    GLfloat m_MoonSpin;      // Angle of Moon rotation
-    clock_t m_AnimationTime; // A previous moment "animate" has been called at
+    MoonSimulation  m_Simulation;
 
 public:
     MyWindow():             // Constructor
@@ -54,16 +73,21 @@ public:
         m_Alpha(0.),
         m_Beta(10.),
         m_MousePos(-1, -1),
-        m_EarthSpin(0.),
-        m_MoonAlpha(0.),
-        m_MoonSpin(0.),
-        m_AnimationTime(0)
+        m_Simulation()
     {}
 
-    void animate();
+    MoonSimulation& simulation() { return m_Simulation; }
+
+    // Take the latest snapshot of the simulation and redraw
+    // the window; returns false if nothing has moved
+    bool updateScene();
+
+    // Bodies drawn by the render queue
+    enum { EARTH, MERIDIANS, MOON };
 
     void drawScene();       // Draw a scene graph
     void render();          // Render a 3D object
+    static void drawBody(void* window, int body);
 
     virtual void onExpose(XEvent& event);
     virtual void onKeyPress(XEvent& event);
@@ -108,50 +132,49 @@ void MyWindow::drawScene() {
     GLfloat pos[4];
     pos[0] = 10.; pos[1] = 0.; pos[2] = 10.;
     pos[3] = 0.;                // Directional light
-    glLightfv(GL_LIGHT0, GL_POSITION, pos);
 
     // Color of Sun
-    GLfloat color[4];
-    color[0] = 0.25; color[1] = 0.25; color[2] = 0.25; color[3] = 1.;
-    glLightfv(GL_LIGHT0, GL_AMBIENT, color);
-    color[0] = 1.; color[1] = 1.; color[2] = 0.8;
-    glLightfv(GL_LIGHT0, GL_DIFFUSE, color);
-    color[2] = 1.;
-    glLightfv(GL_LIGHT0, GL_SPECULAR, color);
+    GLfloat ambient[4], diffuse[4], specular[4];
+    ambient[0] = 0.25; ambient[1] = 0.25; ambient[2] = 0.25; ambient[3] = 1.;
+    diffuse[0] = 1.; diffuse[1] = 1.; diffuse[2] = 0.8; diffuse[3] = 1.;
+    specular[0] = 1.; specular[1] = 1.; specular[2] = 1.; specular[3] = 1.;
+    setLight(pos, ambient, diffuse, specular);
 
     render();           // Draw all 3D objects
 
     swapBuffers();
 }
 
-void MyWindow::animate() {
-    clock_t curtime = times(0);
-    if (m_AnimationTime == 0) {
-        // The first call
-        m_AnimationTime = curtime;
-        return;
-    }
+MoonSimulation::MoonSimulation():
+    Simulation(STEP_TIME)
+{
+    m_State.earthSpin = 0.;
+    m_State.moonAlpha = 0.;
+    m_State.moonSpin = 0.;
+    m_Snapshots.reset(m_State);
+}
 
-    clock_t dt = curtime - m_AnimationTime;
-    if (dt >= SLEEP_USEC*clocks_per_sec/1000000) {
-        // printf("Animation, curtime = %d\n", (int) curtime);
-        GLfloat Dt = (GLfloat) dt / (GLfloat) clocks_per_sec; // in sec
-
-        m_MoonAlpha += MOON_ROTATION_SPEED * Dt;
-        if (m_MoonAlpha > 360.)
-            m_MoonAlpha -= 360.;
-        m_MoonSpin += MOON_SPIN_SPEED * Dt;
-        if (m_MoonSpin > 360.)
-            m_MoonSpin -= 360.;
-        m_EarthSpin += EARTH_SPIN_SPEED * Dt;
-        if (m_EarthSpin > 360.)
-            m_EarthSpin -= 360.;
-
-        //... drawScene();
-        redraw();
-
-        m_AnimationTime = curtime;
-    }
+void MoonSimulation::step(double dt) {
+    m_State.moonAlpha += MOON_ROTATION_SPEED * dt;
+    if (m_State.moonAlpha > 360.)
+        m_State.moonAlpha -= 360.;
+    m_State.moonSpin += MOON_SPIN_SPEED * dt;
+    if (m_State.moonSpin > 360.)
+        m_State.moonSpin -= 360.;
+    m_State.earthSpin += EARTH_SPIN_SPEED * dt;
+    if (m_State.earthSpin > 360.)
+        m_State.earthSpin -= 360.;
+
+    m_Snapshots.back() = m_State;
+    m_Snapshots.publish();
+    GWindow::wakeUp();          // The drawing thread will take it
+}
+
+bool MyWindow::updateScene() {
+    if (!m_Simulation.snapshots().update())
+        return false;
+    redraw();       // Drawn once on the next Expose
+    return true;
 }
 
 //
@@ -169,6 +192,17 @@ void MyWindow::onKeyPress(XEvent& event) {
         printf("\"%s\" button pressed.\n", keyName);
         if (keyName[0] == 'q') { // quit => close window
             destroyWindow();
+        } else if (keyName[0] == 'p') { // pause/continue animation
+            m_Simulation.setPaused(!m_Simulation.paused());
+        } else if (keyName[0] == 's') { // statistics of the last frame
+            printf(
+                "State changes: %d issued, %d elided\n"
+                "Objects: %d visible, %d culled\n",
+                renderStats().stateChanges,
+                renderStats().stateChangesElided,
+                renderStats().objectsVisible,
+                renderStats().objectsCulled
+            );
         }
     }
 }
@@ -226,55 +260,77 @@ void MyWindow::render() {
     glClearColor(0.2, 0.3, 0.5, 1.); // Background color: dark blue
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Draw Earth
     if (m_Quadric == 0) {
         m_Quadric = gluNewQuadric();    // Create a Quadric object
         gluQuadricNormals(m_Quadric, GLU_SMOOTH);
     }
+
+    const MoonState& state = m_Simulation.snapshots().front();
+
+    // The bodies are drawn by the render queue,
+    // that sorts them by material
+    RenderQueue& queue = renderQueue();
+
+    // Draw Earth
     color[0] = 0.3; color[1] = 0.8; color[2] = 0.6; color[3] = 1.;
-    glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
-    glMaterialf(GL_FRONT, GL_SHININESS, 0.3);
+    int earthMaterial = queue.materialKey(color, 0.3);
+    color[0] = 0.2; color[1] = 0.5; color[2] = 0.4; color[3] = 1.;
+    int meridianMaterial = queue.materialKey(color);
+
+    // The bounding spheres are in the coordinates of bodies
+    BoundingSphere earthBounds = { { 0., 0., 0. }, EARTH_RADIUS };
+    BoundingSphere meridianBounds = { { 0., 0., 0. }, EARTH_RADIUS + 0.005 };
+    BoundingSphere moonBounds = { { 0., 0., 0. }, MOON_RADIUS };
 
-    glRotatef(m_EarthSpin, 0., 1., 0.);
+    glPushMatrix();
+    glRotatef(state.earthSpin, 0., 1., 0.);
     glRotatef(90., 1., 0., 0.);
-    gluSphere(
-        m_Quadric, 
-        EARTH_RADIUS,
-        18,     // Num. slices (similar to lines of longitude)
-        10      // Num. stacks (similar to lines of latitude)
-    );
-    // Draw meridians / parallels
-    color[0] = 0.2; color[1] = 0.5; color[2] = 0.4; color[3] = 1.;
-    glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
-    gluQuadricDrawStyle(m_Quadric, GLU_LINE); // Draw lines only
-    gluSphere(
-        m_Quadric, 
-        EARTH_RADIUS + 0.005,
-        18,     // Num. slices (similar to lines of longitude)
-        10      // Num. stacks (similar to lines of latitude)
-    );
-    gluQuadricDrawStyle(m_Quadric, GLU_FILL); // Restore the normal draw style
-    glRotatef(-90., 1., 0., 0.);
-    glRotatef(-m_EarthSpin, 0., 1., 0.);
+    queue.submit(earthMaterial, &drawBody, this, EARTH, earthBounds);
+    queue.submit(meridianMaterial, &drawBody, this, MERIDIANS, meridianBounds);
+    glPopMatrix();
 
     // Draw Moon
-    glRotatef(m_MoonAlpha, 0., 1., 0.); // Orbit rotation
+    glRotatef(state.moonAlpha, 0., 1., 0.); // Orbit rotation
 
     // Shift Moon center
     glTranslatef(MOON_ORBIT_RADIUS, 0., 0.);
     color[0] = 0.2; color[1] = 0.6; color[2] = 1.;
-    glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
-    glMaterialf(GL_FRONT, GL_SHININESS, 0.6);
+    int moonMaterial = queue.materialKey(color, 0.6);
 
     glRotatef(-90., 1., 0., 0.);
-    glRotatef(m_MoonSpin, 0., 1., 0.);  // Moon spin
+    glRotatef(state.moonSpin, 0., 1., 0.);  // Moon spin
+    queue.submit(moonMaterial, &drawBody, this, MOON, moonBounds);
 
-    gluSphere(
-        m_Quadric, 
-        MOON_RADIUS,
-        16,     // Num. slices (similar to lines of longitude)
-        8       // Num. stacks (similar to lines of latitude)
-    );
+    queue.flush();
+}
+
+void MyWindow::drawBody(void* window, int body) {
+    GLUquadricObj* quadric = ((MyWindow*) window)->m_Quadric;
+    if (body == EARTH) {
+        gluSphere(
+            quadric, 
+            EARTH_RADIUS,
+            18,     // Num. slices (similar to lines of longitude)
+            10      // Num. stacks (similar to lines of latitude)
+        );
+    } else if (body == MERIDIANS) {
+        // Draw meridians / parallels
+        gluQuadricDrawStyle(quadric, GLU_LINE); // Draw lines only
+        gluSphere(
+            quadric, 
+            EARTH_RADIUS + 0.005,
+            18,     // Num. slices (similar to lines of longitude)
+            10      // Num. stacks (similar to lines of latitude)
+        );
+        gluQuadricDrawStyle(quadric, GLU_FILL); // Restore the normal style
+    } else {
+        gluSphere(
+            quadric, 
+            MOON_RADIUS,
+            16,     // Num. slices (similar to lines of longitude)
+            8       // Num. stacks (similar to lines of latitude)
+        );
+    }
 }
 
 /////////////////////////////////////////////////////////////
@@ -284,8 +340,8 @@ int main() {
     XEvent e;
 
     // Initialize X stuff
-    if (!GWindow::initX()) {
-        printf("Could not connect to X-server.\n");
+    if (!GLWindow::initGraphics()) {
+        printf("Could not initialize graphics.\n");
         exit(1);
     }
 
@@ -320,23 +376,20 @@ int main() {
         -2., 2.                         // near, far
     );
 
-    clocks_per_sec = (time_t) sysconf(_SC_CLK_TCK);
-
-    // Message loop, animation
+    // Message loop. This thread handles the events and draws the scene,
+    // the bodies are moved by the simulation thread
+    w.setFrameRate(FRAME_RATE);
+    w.simulation().start();
     while (!finished) {
         if (GLWindow::getNextEvent(e)) {
             GLWindow::dispatchEvent(e);
-        } else {
-
-            // Sleep a bit (we use select for sleeping)
-            timeval dt;
-            dt.tv_sec = 0;
-            dt.tv_usec = 10000; // sleeping time 0.01 sec
-            select(1, 0, 0, 0, &dt);
-
-            w.animate();
+        } else if (!w.updateScene()) {
+            // Sleep until an event comes or the bodies move
+            GWindow::waitEvent();
         }
     }
+    w.simulation().stop();
+    printFrameTimeStats(w.frameTimeStats());
 
     GWindow::closeX();
     return 0;
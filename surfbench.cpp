@@ -0,0 +1,92 @@
+//
+// Benchmark of the surface evaluator:
+// fill heights and normals of the radial cosine
+// z = 0.5*cos(6*r) / (1 + r*r) on the square [-2.5, 2.5]^2
+// and report the speed in millions of vertices per second.
+//
+// Usage: surfbench [step [numThreads]]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/time.h>
+#include "SurfaceGrid.h"
+
+static double currentTime() {
+    timeval t;
+    gettimeofday(&t, 0);
+    return (double) t.tv_sec + (double) t.tv_usec * 1e-6;
+}
+
+// The same evaluation as in the old func.cpp: one call of f
+// for the height and four calls for the gradient
+static void evaluateNaive(
+    const SurfaceFunction& f, const SurfaceGrid& g, float* out
+) {
+    double h = 0.0001;
+    for (int j = 0; j < g.m_NY; ++j) {
+        double y = g.m_YMin + j*g.m_DY;
+        for (int i = 0; i < g.m_NX; ++i) {
+            double x = g.m_XMin + i*g.m_DX;
+            double dFx = -(f.value(x+h, y) - f.value(x-h, y)) / (2.*h);
+            double dFy = -(f.value(x, y+h) - f.value(x, y-h)) / (2.*h);
+            double len = sqrt(dFx*dFx + dFy*dFy + 1.);
+            out[0] = (float) f.value(x, y);
+            out[1] = (float) (dFx / len);
+            out[2] = (float) (dFy / len);
+            out[3] = (float) (1. / len);
+        }
+    }
+}
+
+static void report(const char* name, int numVertices, double seconds) {
+    printf(
+        "%-30s %8.3f sec  %8.2f Mvertices/s\n",
+        name, seconds, (double) numVertices / seconds * 1e-6
+    );
+}
+
+int main(int argc, char* argv[]) {
+    double step = 0.001;
+    int numThreads = 0;
+    if (argc > 1)
+        step = atof(argv[1]);
+    if (argc > 2)
+        numThreads = atoi(argv[2]);
+    if (step <= 0.)
+        step = 0.001;
+
+    RadialCosine f;
+    SurfaceGrid grid;
+    grid.setDomain(-2.5, 2.5, -2.5, 2.5, step, step);
+    int n = grid.numVertices();
+    printf("Grid %d x %d = %d vertices, step %g\n",
+        grid.m_NX, grid.m_NY, n, step);
+
+    float out[4];
+    double t = currentTime();
+    evaluateNaive(f, grid, out);
+    report("Naive (5 calls of f)", n, currentTime() - t);
+
+    ThreadPool single(1);
+    grid.evaluate(f, &single);      // Touch the memory of arrays
+
+    grid.m_ExactNormals = false;
+    t = currentTime();
+    grid.evaluate(f, &single);
+    report("Grid differences, 1 thread", n, currentTime() - t);
+
+    grid.m_ExactNormals = true;
+    t = currentTime();
+    grid.evaluate(f, &single);
+    report("Dual numbers, 1 thread", n, currentTime() - t);
+
+    ThreadPool pool(numThreads);
+    char name[64];
+    sprintf(name, "Dual numbers, %d thread(s)", pool.numThreads());
+    t = currentTime();
+    grid.evaluate(f, &pool);
+    report(name, n, currentTime() - t);
+
+    return 0;
+}
@@ -143,11 +143,13 @@ void MyWindow::render() {
     GLfloat x2 = (-x1),   y2 = y0,           z2 = z1;
     GLfloat x3 = 0.,      y3 = height*3./4., z3 = 0.;
 
-    // Draw a tetrahedron
+    // Draw a tetrahedron, the colors of faces are given per vertex
+    color[0] = 1.; color[1] = 1.; color[2] = 1.; color[3] = 1.;
+    setMaterial(color);
     glBegin(GL_TRIANGLES);
         // Bottom face --------------------------------------
         color[0] = 0.2; color[1] = 1.; color[2] = 0.2;  // Green
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
+        setVertexColor(color);
 
         // Set a normal to the bottom face
         normal[0] = 0.;
@@ -162,7 +164,7 @@ void MyWindow::render() {
 
         // Right side face --------------------------------------
         color[0] = 1.; color[1] = 0.2; color[2] = 0.2;  // Red
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
+        setVertexColor(color);
 
         // Set a normal to the right side face
         normal[0] = (x0 + x1 + x3) / 3.;
@@ -177,7 +179,7 @@ void MyWindow::render() {
 
         // Back face --------------------------------------
         color[0] = 0.9; color[1] = 0.8; color[2] = 0.1; // Yellow
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
+        setVertexColor(color);
 
         // Define the normal to the face
         normal[0] = (x1 + x2 + x3) / 3.;
@@ -192,7 +194,7 @@ void MyWindow::render() {
 
         // Left side face --------------------------------------
         color[0] = 0.2; color[1] = 0.2; color[2] = 1.;  // Blue
-        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
+        setVertexColor(color);
 
         // Define the normal to the face
         normal[0] = (x0 + x2 + x3) / 3.;
@@ -213,7 +215,7 @@ void MyWindow::render() {
     }
     glTranslatef(x3, y3, z3);
     color[0] = 0.2; color[1] = 0.6; color[2] = 0.9;
-    glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, color);
+    setMaterial(color);
 
     gluSphere(
         m_Quadric, 
@@ -228,8 +230,8 @@ void MyWindow::render() {
 //       and start the message loop
 int main() {
     // Initialize X stuff
-    if (!GWindow::initX()) {
-        printf("Could not connect to X-server.\n");
+    if (!GLWindow::initGraphics()) {
+        printf("Could not initialize graphics.\n");
         exit(1);
     }
 
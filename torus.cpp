@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include "GLWindow.h"
+#include "Dual.h"
 
 //--------------------------------------------------
 // Definition of class "MyWindow"
@@ -31,7 +32,7 @@ public:
         m_MousePos(-1, -1)
     {}
 
-    double f(double x, double y);       // Draw a scene graph
+    template <class Real> Real f(const Real& x, const Real& y); // z = f(x, y)
     void gradient(double x, double y, GLfloat grad[3]);
     void render();                      // Draw a scene graph
     void setColor(double z);
@@ -43,8 +44,10 @@ public:
     virtual void onMotionNotify(XEvent& event);
 };
 
-double MyWindow::f(double x, double y) {
-    double r = sqrt(x*x+y*y);
+// The function is a template, so it can be evaluated
+// both with double and Dual2 arguments
+template <class Real> Real MyWindow::f(const Real& x, const Real& y) {
+    Real r = sqrt(x*x+y*y);
     return (
         0.5*cos(6.*r) /
         (1. + r*r)
@@ -54,10 +57,10 @@ double MyWindow::f(double x, double y) {
 void MyWindow::gradient(double x, double y, GLfloat grad[3]) {
     // z = f(x, y)
     // F(x, y, z) = z - f(x, y)
-    double dx = 0.0001;
-    double dy = 0.0001;
-    double dFx = -(f(x+dx, y) - f(x-dx, y)) / (2.*dx);
-    double dFy = -(f(x, y+dy) - f(x, y-dy)) / (2.*dy);
+    // The partial derivatives are computed by the dual numbers
+    Dual2 z = f(Dual2::variableX(x), Dual2::variableY(y));
+    double dFx = -z.dx;
+    double dFy = -z.dy;
     double dFz = 1.;
     double len = sqrt(dFx*dFx + dFy*dFy + dFz*dFz);
     if (len <= 0.)
@@ -298,8 +301,8 @@ void MyWindow::render() {
 //       and start the message loop
 int main() {
     // Initialize X stuff
-    if (!GWindow::initX()) {
-        printf("Could not connect to X-server.\n");
+    if (!GLWindow::initGraphics()) {
+        printf("Could not initialize graphics.\n");
         exit(1);
     }
 